@@ -0,0 +1,428 @@
+/* Compacting a graph's links.
+ * Each word's neighbours are stored as the gaps between them, which are
+ * small when one-letter neighbours have nearby numbers, so the words are
+ * first renumbered in Cuthill-McKee order: a BFS through each component
+ * from its least linked word, taking neighbours least linked first, so that
+ * each word's neighbours are numbered close together and close to it.
+ * The gaps are then coded stream-vbyte style: a word's code is its number
+ * of neighbours as a varint, a control byte for every four gaps giving each
+ * one's length in 2 bits, then the gaps themselves in 1 to 4 bytes, low
+ * byte first.  Keeping the lengths apart from the data means a decoder never
+ * has to test a byte to know where the next gap starts.  The first gap is
+ * from the word itself, zigzagged as it can go either way; the rest are one
+ * less than the step up from the neighbour before.
+ * Where each word's code starts is an int for every CBLOCK words and a
+ * short for each word within its block.  A graph whose blocks are too big
+ * for a short is left as it is.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "wlprivate.h"
+
+static wlerr compactGraph(wlgraph *g, int nthreads, int arg);
+static wlerr renumber(wlgraph *g, int *order);
+static int   codeWord(const int *nbrs, int deg, int u, unsigned char *out);
+static int   degreeOrder(const wlgraph *g, int *ids);
+static void  sortByDegree(const wlgraph *g, int *ids, int n);
+
+/* A gap is read as four bytes and masked to its length, which saves a
+ * branch per gap but can read 3 bytes past the end of the code.  The four
+ * bytes are one unaligned load where the machine is little-endian, as the
+ * gaps are stored low byte first. */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define LOADGAP(x, p) ((x) = (p)[0] | (uint32_t)(p)[1] << 8 \
+                       | (uint32_t)(p)[2] << 16 | (uint32_t)(p)[3] << 24)
+#else
+#define LOADGAP(x, p) memcpy(&(x), (p), 4)
+#endif
+
+static const uint32_t gapmask[4] = {
+  0xff, 0xffff, 0xffffff, 0xffffffff
+};
+
+/* For each control byte, where its second, third and fourth gaps start
+ * and where the next control byte's gaps start, a byte each - so a word's
+ * gaps are decoded four at a time, with no sums between them. */
+#define GAPLEN(c, k) (((c) >> (2 * (k)) & 3) + 1)
+#define GAPOFFS(c) ((uint32_t)GAPLEN(c, 0) \
+                    | (uint32_t)(GAPLEN(c, 0) + GAPLEN(c, 1)) << 8 \
+                    | (uint32_t)(GAPLEN(c, 0) + GAPLEN(c, 1) \
+                                 + GAPLEN(c, 2)) << 16 \
+                    | (uint32_t)(GAPLEN(c, 0) + GAPLEN(c, 1) + GAPLEN(c, 2) \
+                                 + GAPLEN(c, 3)) << 24)
+#define GAPOFFS4(c) GAPOFFS(c), GAPOFFS(c + 1), GAPOFFS(c + 2), GAPOFFS(c + 3)
+#define GAPOFFS16(c) GAPOFFS4(c), GAPOFFS4(c + 4), GAPOFFS4(c + 8), \
+                     GAPOFFS4(c + 12)
+#define GAPOFFS64(c) GAPOFFS16(c), GAPOFFS16(c + 16), GAPOFFS16(c + 32), \
+                     GAPOFFS16(c + 48)
+
+static const uint32_t gapoffs[256] = {
+  GAPOFFS64(0), GAPOFFS64(64), GAPOFFS64(128), GAPOFFS64(192)
+};
+
+wlerr wlCompact(wldict *dict, int nthreads)
+{
+  int i;
+  wlerr err;
+  STAT(const wlgraph *g);
+
+  if (dict->image != NULL) {
+    return wl_badarg;
+  }
+  for (i = 0; i <= dict->maxlen; i++) {
+    if (dict->graphs[i] != NULL
+    &&  (dict->graphs[i]->comp != NULL || dict->graphs[i]->lfirst != NULL)) {
+      return wl_badarg; /* they are indexed by the old numbers */
+    }
+  }
+  err = wlEachGraph(dict, compactGraph, 0, wlThreadCount(nthreads));
+#ifdef WL_STATS
+  for (i = 0; i <= dict->maxlen; i++) {
+    if ((g = dict->graphs[i]) != NULL && g->code != NULL) {
+      dict->bytes += sizeof(unsigned int) * ((long)g->n / CBLOCK + 2)
+        + sizeof(unsigned short) * (long)g->n
+        + g->cblock[(g->n + CBLOCK - 1) / CBLOCK]
+        - sizeof(int) * ((long)g->n + 1 + g->m);
+    }
+  }
+#endif
+  return err;
+}
+
+int wlAdjacent(const wlgraph *g, int u, int *buf, const int **nbrs)
+/* The heart of every search on a compacted graph.  The first gap is
+ * unzigzagged on its own; after that, whole control bytes are decoded four
+ * gaps at a time, and whatever is left over one at a time. */
+{
+  const unsigned char *p, *data;
+  uint32_t x, x1, x2, x3, o;
+  int deg, shift, i, c, v;
+
+  if (g->code == NULL) {
+    *nbrs = g->adj + g->first[u];
+    return g->first[u + 1] - g->first[u];
+  }
+  p = g->code + g->cblock[u / CBLOCK] + g->coff[u];
+  for (deg = 0, shift = 0; *p & 0x80; shift += 7) {
+    deg |= (*p++ & 0x7f) << shift;
+  }
+  deg |= *p++ << shift;
+  *nbrs = buf;
+  if (deg == 0) {
+    return 0;
+  }
+  data = p + (deg + 3) / 4;
+  LOADGAP(x, data);
+  x &= gapmask[*p & 3];
+  data += (*p & 3) + 1;
+  buf[0] = v = u + (int)(x >> 1 ^ (0 - (x & 1)));
+  for (i = 1; i < deg && (i & 3) != 0; i++) {
+    c = p[0] >> (i * 2) & 3;
+    LOADGAP(x, data);
+    data += c + 1;
+    buf[i] = v += (int)(x & gapmask[c]) + 1;
+  }
+  for (; i + 4 <= deg; i += 4) {
+    c = p[i >> 2];
+    o = gapoffs[c];
+    LOADGAP(x, data);
+    LOADGAP(x1, data + (o & 0xff));
+    LOADGAP(x2, data + (o >> 8 & 0xff));
+    LOADGAP(x3, data + (o >> 16 & 0xff));
+    data += o >> 24;
+    buf[i] = v += (int)(x & gapmask[c & 3]) + 1;
+    buf[i + 1] = v += (int)(x1 & gapmask[c >> 2 & 3]) + 1;
+    buf[i + 2] = v += (int)(x2 & gapmask[c >> 4 & 3]) + 1;
+    buf[i + 3] = v += (int)(x3 & gapmask[c >> 6]) + 1;
+  }
+  for (; i < deg; i++) {
+    c = p[i >> 2] >> ((i & 3) * 2) & 3;
+    LOADGAP(x, data);
+    data += c + 1;
+    buf[i] = v += (int)(x & gapmask[c]) + 1;
+  }
+  return deg;
+}
+
+static wlerr compactGraph(wlgraph *g, int nthreads, int arg)
+/* codes every word twice: once to find where each one's code goes, and
+ * once to put it there */
+{
+  int *order = (int *)malloc(sizeof(int) * (g->n + 1));
+  int nblocks = (g->n + CBLOCK - 1) / CBLOCK;
+  unsigned int pos = 0;
+  int u, len;
+  wlerr err;
+
+  (void)nthreads;
+  (void)arg;
+  if (order == NULL) {
+    return wl_nomem;
+  }
+  err = renumber(g, order);
+  free(order);
+  if (err != wl_ok) {
+    return err;
+  }
+  g->cblock = (unsigned int *)malloc(sizeof(unsigned int) * (nblocks + 1));
+  g->coff = (unsigned short *)malloc(sizeof(unsigned short) * (g->n + 1));
+  if (g->cblock == NULL || g->coff == NULL) {
+    free(g->cblock);
+    free(g->coff);
+    g->cblock = NULL;
+    g->coff = NULL;
+    return wl_nomem;
+  }
+  for (u = 0; u < g->n; u++) {
+    if (u % CBLOCK == 0) {
+      g->cblock[u / CBLOCK] = pos;
+    }
+    len = codeWord(g->adj + g->first[u], g->first[u + 1] - g->first[u], u,
+                   NULL);
+    if (pos - g->cblock[u / CBLOCK] > 0xffff) {
+      free(g->cblock);
+      free(g->coff);
+      g->cblock = NULL;
+      g->coff = NULL;
+      return wl_ok; /* a block too big for its offsets - see the top */
+    }
+    g->coff[u] = (unsigned short)(pos - g->cblock[u / CBLOCK]);
+    pos += len;
+  }
+  g->cblock[nblocks] = pos;
+  if ((g->code = (unsigned char *)calloc(pos + 3, 1)) == NULL) {
+    free(g->cblock);
+    free(g->coff);
+    g->cblock = NULL;
+    g->coff = NULL;
+    return wl_nomem;
+  }
+  for (u = 0; u < g->n; u++) {
+    codeWord(g->adj + g->first[u], g->first[u + 1] - g->first[u], u,
+             g->code + g->cblock[u / CBLOCK] + g->coff[u]);
+  }
+  free(g->first);
+  free(g->adj);
+  g->first = g->adj = NULL;
+  return wl_ok;
+}
+
+static int codeWord(const int *nbrs, int deg, int u, unsigned char *out)
+/* codes one word's sorted neighbours at out, unless out is NULL, and
+ * returns the length of the code */
+{
+  unsigned char *ctrl = NULL, *data = NULL;
+  unsigned int x;
+  int len = 0, i, c, d = deg;
+
+  while (d >= 0x80) {
+    if (out != NULL) {
+      out[len] = (unsigned char)((d & 0x7f) | 0x80);
+    }
+    len++;
+    d >>= 7;
+  }
+  if (out != NULL) {
+    out[len] = (unsigned char)d;
+    ctrl = out + len + 1;
+    data = ctrl + (deg + 3) / 4;
+    memset(ctrl, 0, (deg + 3) / 4);
+  }
+  len += 1 + (deg + 3) / 4;
+  for (i = 0; i < deg; i++) {
+    if (i == 0) {
+      x = nbrs[0] >= u ? (unsigned int)(nbrs[0] - u) * 2
+                       : (unsigned int)(u - nbrs[0]) * 2 - 1;
+    }
+    else {
+      x = (unsigned int)(nbrs[i] - nbrs[i - 1] - 1);
+    }
+    c = x < 0x100 ? 0 : x < 0x10000 ? 1 : x < 0x1000000 ? 2 : 3;
+    if (out != NULL) {
+      ctrl[i >> 2] |= (unsigned char)(c << ((i & 3) * 2));
+      data[0] = (unsigned char)x;
+      if (c > 0) {
+        data[1] = (unsigned char)(x >> 8);
+      }
+      if (c > 1) {
+        data[2] = (unsigned char)(x >> 16);
+      }
+      if (c > 2) {
+        data[3] = (unsigned char)(x >> 24);
+      }
+      data += c + 1;
+    }
+    len += c + 1;
+  }
+  return len;
+}
+
+static wlerr renumber(wlgraph *g, int *order)
+/* Puts the words in Cuthill-McKee order, rewriting words, first and adj in
+ * the new numbers and rebuilding the hash table.  order is left holding
+ * each new number's old one. */
+{
+  int *pos = (int *)malloc(sizeof(int) * (g->n + 1));
+  int *first = (int *)malloc(sizeof(int) * (g->n + 1));
+  int *adj = (int *)malloc(sizeof(int) * (g->m + 1));
+  char *words = (char *)malloc((size_t)g->n * (g->wlen + 1));
+  int *byDeg = (int *)malloc(sizeof(int) * (g->n + 1));
+  int front, back = 0, s, u, i, j, v;
+
+  if (pos == NULL || first == NULL || adj == NULL || words == NULL
+  ||  byDeg == NULL || !degreeOrder(g, byDeg)) {
+    free(pos);
+    free(first);
+    free(adj);
+    free(words);
+    free(byDeg);
+    return wl_nomem;
+  }
+  for (u = 0; u < g->n; u++) {
+    pos[u] = -1;
+  }
+  for (s = 0; s < g->n; s++) {
+    if (pos[byDeg[s]] != -1) {
+      continue;
+    }
+    pos[byDeg[s]] = back;
+    order[back++] = byDeg[s];
+    for (front = back - 1; front < back; front++) {
+      u = order[front];
+      i = back;
+      for (j = g->first[u]; j < g->first[u + 1]; j++) {
+        if (pos[g->adj[j]] == -1) {
+          pos[g->adj[j]] = back;
+          order[back++] = g->adj[j];
+        }
+      }
+      sortByDegree(g, order + i, back - i);
+      for (; i < back; i++) {
+        pos[order[i]] = i;
+      }
+    }
+  }
+
+  first[0] = 0;
+  for (i = 0; i < g->n; i++) {
+    u = order[i];
+    memcpy(words + (size_t)i * (g->wlen + 1), WORD(g, u), g->wlen + 1);
+    first[i + 1] = first[i] + g->first[u + 1] - g->first[u];
+    for (j = g->first[u]; j < g->first[u + 1]; j++) {
+      v = pos[g->adj[j]];
+      for (s = first[i] + j - g->first[u]; s > first[i] && adj[s - 1] > v;
+           s--) {
+        adj[s] = adj[s - 1];
+      }
+      adj[s] = v;
+    }
+  }
+  free(g->words);
+  free(g->first);
+  free(g->adj);
+  free(g->table);
+  g->words = words;
+  g->first = first;
+  g->adj = adj;
+  g->table = NULL;
+  free(pos);
+  free(byDeg);
+  return wlBuildTable(g);
+}
+
+static int degreeOrder(const wlgraph *g, int *ids)
+/* counting sort of every word, fewest neighbours first - returns 0 if out
+ * of memory */
+{
+  int *cnt = (int *)calloc(g->maxdeg + 2, sizeof(int));
+  int u;
+
+  if (cnt == NULL) {
+    return 0;
+  }
+  for (u = 0; u < g->n; u++) {
+    cnt[g->first[u + 1] - g->first[u] + 1]++;
+  }
+  for (u = 0; u <= g->maxdeg; u++) {
+    cnt[u + 1] += cnt[u];
+  }
+  for (u = 0; u < g->n; u++) {
+    ids[cnt[g->first[u + 1] - g->first[u]]++] = u;
+  }
+  free(cnt);
+  return 1;
+}
+
+static void sortByDegree(const wlgraph *g, int *ids, int n)
+/* insertion sort, fewest neighbours first, for a word's new neighbours */
+{
+  int i, j, u;
+
+  for (i = 1; i < n; i++) {
+    u = ids[i];
+    for (j = i - 1; j >= 0 && g->first[ids[j] + 1] - g->first[ids[j]]
+                              > g->first[u + 1] - g->first[u]; j--) {
+      ids[j + 1] = ids[j];
+    }
+    ids[j + 1] = u;
+  }
+}
+
+int wlCheckCode(const wlgraph *g, int ncode)
+/* Checks that a loaded graph's code, ncode bytes long, can be decoded
+ * without reading past any word's code or yielding a word number out of
+ * range - it's too late for wlAdjacent() to check. */
+{
+  const unsigned char *p, *data, *end;
+  unsigned int x;
+  int nblocks = (g->n + CBLOCK - 1) / CBLOCK, u, deg, shift, i, j, c, v;
+
+  for (i = 0; i < nblocks; i++) {
+    if (g->cblock[i] > g->cblock[i + 1]) {
+      return 0;
+    }
+  }
+  if (g->cblock[0] != 0 || g->cblock[nblocks] != (unsigned int)ncode) {
+    return 0;
+  }
+  for (u = 0; u < g->n; u++) {
+    p = g->code + g->cblock[u / CBLOCK] + g->coff[u];
+    end = u + 1 < g->n ? g->code + g->cblock[(u + 1) / CBLOCK]
+                         + g->coff[u + 1]
+                       : g->code + ncode;
+    if (end < p || end > g->code + ncode) {
+      return 0;
+    }
+    for (deg = 0, shift = 0; p < end && *p & 0x80 && shift < 21; shift += 7) {
+      deg |= (*p++ & 0x7f) << shift;
+    }
+    if (p == end) {
+      return 0;
+    }
+    deg |= *p++ << shift;
+    if (deg > g->maxdeg || end - p < (deg + 3) / 4) {
+      return 0;
+    }
+    data = p + (deg + 3) / 4;
+    for (i = 0, v = u; i < deg; i++) {
+      c = (p[i >> 2] >> ((i & 3) * 2) & 3) + 1;
+      if (end - data < c) {
+        return 0;
+      }
+      for (x = 0, j = c; j > 0; j--) {
+        x = x << 8 | data[j - 1];
+      }
+      data += c;
+      if (x > (unsigned int)g->n * 2) {
+        return 0;
+      }
+      v = i == 0 ? (x & 1 ? u - (int)(x >> 1) - 1 : u + (int)(x >> 1))
+                 : v + (int)x + 1;
+      if (v < 0 || v >= g->n) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
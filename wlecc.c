@@ -0,0 +1,336 @@
+/* Eccentricities - how far each word is from the word furthest from it.
+ * A BFS from every word would find them all, but costs a BFS per word.
+ * Instead each word keeps a lower and an upper bound on its eccentricity,
+ * and each BFS tightens the bounds of every word it reaches: a word d steps
+ * from a source of eccentricity e has an eccentricity of at least d and of
+ * at least e - d, and at most e + d.  Sources are taken in turn as the
+ * unsettled word with the highest upper bound and the one with the lowest
+ * lower bound, so that both the edges and the middle of each component are
+ * pinned down early (Takes and Kosters' bounding method - iFUB is its
+ * diameter-only cousin), and the search stops once every word's bounds
+ * meet.  Usually only a few percent of the words need a BFS of their own.
+ * The BFSs are run LANES at a time, one bit per source in each word's
+ * masks as in the batch search in wlsearch.c, and each thread runs its own
+ * LANES.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "wlprivate.h"
+
+#define LANES 64
+
+typedef struct eccjob {
+  const wlgraph *g;
+  int nsrc;
+  int src[LANES];
+  int ecc[LANES];
+  uint64_t *seen; /* by word, the lanes that have reached it */
+  uint64_t *visit; /* by word, the lanes for which it is on the frontier */
+  uint64_t *next; /* by word, the lanes reaching it on the next level */
+  unsigned short *dist; /* by word and lane, valid where seen */
+  int *buf;
+  wlerr err;
+} eccjob;
+
+static void *searchLanes(void *arg);
+static int   pickSources(const wlgraph *g, const int *lo, const int *hi,
+                         const int *deg, char *picked, eccjob *jobs,
+                         int njobs);
+static int   tighten(const eccjob *job, int *lo, int *hi);
+static int   eccentricity(const wlgraph *g, int from, int *dist, int *queue,
+                          int *buf);
+static int   relax(const wlgraph *g, const int *deg, const int *size,
+                   const int *comp, int *lo, int *hi, int *buf);
+
+wlerr wlEccentricities(const wlgraph *g, int nthreads, int *ecc, int *comp,
+                       int *searches)
+{
+  eccjob jobs[MAXTHREADS];
+  int *lo = (int *)malloc(sizeof(int) * g->n);
+  int *hi = (int *)malloc(sizeof(int) * g->n);
+  int *deg = (int *)malloc(sizeof(int) * g->n);
+  int *queue = (int *)malloc(sizeof(int) * g->n);
+  int *size = (int *)calloc(g->n, sizeof(int));
+  int *buf = (int *)malloc(sizeof(int) * (g->maxdeg + 1));
+  char *picked = (char *)calloc(g->n, 1);
+  const int *nbrs;
+  int t, v, njobs, left = 0, nsearch = 0;
+  wlerr err = wl_ok;
+
+  nthreads = wlThreadCount(nthreads);
+  for (t = 0; t < nthreads; t++) {
+    jobs[t].g = g;
+    jobs[t].seen = (uint64_t *)malloc(sizeof(uint64_t) * g->n);
+    jobs[t].visit = (uint64_t *)malloc(sizeof(uint64_t) * g->n);
+    jobs[t].next = (uint64_t *)calloc(g->n, sizeof(uint64_t));
+    jobs[t].dist = (unsigned short *)malloc(sizeof(unsigned short) * LANES
+                                            * (size_t)g->n);
+    jobs[t].buf = (int *)malloc(sizeof(int) * (g->maxdeg + 1));
+    jobs[t].err = wl_ok;
+    if (jobs[t].seen == NULL || jobs[t].visit == NULL
+    ||  jobs[t].next == NULL || jobs[t].dist == NULL || jobs[t].buf == NULL) {
+      err = wl_nomem;
+    }
+  }
+  if (lo == NULL || hi == NULL || deg == NULL || queue == NULL
+  ||  size == NULL || buf == NULL || picked == NULL) {
+    err = wl_nomem;
+  }
+  if (err == wl_ok) {
+    /* A word in a component of no more than LANES words is given a BFS of
+     * its own, which only goes round the component - cheaper than a pass
+     * over the whole graph per level.  The rest start out bounded by the
+     * size of their components. */
+    wlComponents(g, comp, queue, buf);
+    for (v = 0; v < g->n; v++) {
+      size[comp[v]]++;
+      ecc[v] = -1; /* for eccentricity() to mark distances in */
+    }
+    for (v = 0; v < g->n; v++) {
+      deg[v] = wlAdjacent(g, v, buf, &nbrs);
+      if (size[comp[v]] <= LANES) {
+        lo[v] = hi[v] = eccentricity(g, v, ecc, queue, buf);
+        nsearch += deg[v] > 0;
+      }
+      else {
+        lo[v] = 0;
+        hi[v] = size[comp[v]] - 1;
+        left++;
+      }
+    }
+  }
+  while (err == wl_ok && left > 0) {
+    njobs = pickSources(g, lo, hi, deg, picked, jobs, nthreads);
+    wlRunThreads(searchLanes, jobs, sizeof(eccjob), njobs);
+    for (t = 0; t < njobs; t++) {
+      if (jobs[t].err != wl_ok) {
+        err = jobs[t].err;
+      }
+    }
+    for (t = 0; t < njobs && err == wl_ok; t++) {
+      left -= tighten(&jobs[t], lo, hi);
+      nsearch += jobs[t].nsrc;
+    }
+    while (err == wl_ok && left > 0) {
+      if ((t = relax(g, deg, size, comp, lo, hi, buf)) < 0) {
+        break; /* nothing changed */
+      }
+      left -= t;
+    }
+  }
+  if (err == wl_ok) {
+    memcpy(ecc, lo, sizeof(int) * g->n);
+    if (searches != NULL) {
+      *searches = nsearch;
+    }
+  }
+  for (t = 0; t < nthreads; t++) {
+    free(jobs[t].seen);
+    free(jobs[t].visit);
+    free(jobs[t].next);
+    free(jobs[t].dist);
+    free(jobs[t].buf);
+  }
+  free(lo);
+  free(hi);
+  free(deg);
+  free(queue);
+  free(size);
+  free(buf);
+  free(picked);
+  return err;
+}
+
+static int eccentricity(const wlgraph *g, int from, int *dist, int *queue,
+                        int *buf)
+/* BFS from word from, returning the distance to the last word it reaches.
+ * dist must be -1 for every word, and is left that way. */
+{
+  const int *nbrs;
+  int front, back, u, i, deg;
+
+  dist[from] = 0;
+  queue[0] = from;
+  for (front = 0, back = 1; front < back; front++) {
+    u = queue[front];
+    deg = wlAdjacent(g, u, buf, &nbrs);
+    for (i = 0; i < deg; i++) {
+      if (dist[nbrs[i]] == -1) {
+        dist[nbrs[i]] = dist[u] + 1;
+        queue[back++] = nbrs[i];
+      }
+    }
+  }
+  u = dist[queue[back - 1]];
+  for (i = 0; i < back; i++) {
+    dist[queue[i]] = -1;
+  }
+  return u;
+}
+
+static int pickSources(const wlgraph *g, const int *lo, const int *hi,
+                       const int *deg, char *picked, eccjob *jobs, int njobs)
+/* Fills up to njobs jobs with unsettled words, alternately the one with the
+ * highest upper bound and the one with the lowest lower bound, and returns
+ * the number of jobs with any.  Ties go to the word with the most
+ * neighbours, whose BFS settles the most. */
+{
+  int t, q, v, best, n = 0;
+
+  for (t = 0; t < njobs; t++) {
+    jobs[t].nsrc = 0;
+  }
+  for (t = 0, q = 0; t < njobs; n++) {
+    best = -1;
+    for (v = 0; v < g->n; v++) {
+      if (picked[v] || lo[v] == hi[v]) {
+        continue;
+      }
+      if (best == -1
+      ||  (n % 2 == 0 ? hi[v] > hi[best] : lo[v] < lo[best])
+      ||  ((n % 2 == 0 ? hi[v] == hi[best] : lo[v] == lo[best])
+           && deg[v] > deg[best])) {
+        best = v;
+      }
+    }
+    if (best == -1) {
+      break;
+    }
+    picked[best] = 1;
+    jobs[t].src[q] = best;
+    jobs[t].nsrc = ++q;
+    if (q == LANES) {
+      t++;
+      q = 0;
+    }
+  }
+  for (t = 0; t < njobs; t++) {
+    for (q = 0; q < jobs[t].nsrc; q++) {
+      picked[jobs[t].src[q]] = 0;
+    }
+  }
+  for (t = 0; t < njobs && jobs[t].nsrc > 0; t++)
+    ;
+  return t;
+}
+
+static void *searchLanes(void *arg)
+/* one BFS per source, a level at a time for all of them together */
+{
+  eccjob *job = (eccjob *)arg;
+  const wlgraph *g = job->g;
+  const int *nbrs;
+  uint64_t x;
+  int u, v, i, q, deg, level, active;
+
+  memset(job->seen, 0, sizeof(uint64_t) * g->n);
+  memset(job->visit, 0, sizeof(uint64_t) * g->n);
+  for (q = 0; q < job->nsrc; q++) {
+    job->seen[job->src[q]] |= (uint64_t)1 << q;
+    job->visit[job->src[q]] |= (uint64_t)1 << q;
+    job->dist[(size_t)job->src[q] * LANES + q] = 0;
+    job->ecc[q] = 0;
+  }
+  for (level = 1, active = 1; active; level++) {
+    if (level == UNREACHED) {
+      job->err = wl_badarg; /* a component too long for a short */
+      return NULL;
+    }
+    for (u = 0; u < g->n; u++) {
+      if (job->visit[u] != 0) {
+        deg = wlAdjacent(g, u, job->buf, &nbrs);
+        for (i = 0; i < deg; i++) {
+          job->next[nbrs[i]] |= job->visit[u];
+        }
+      }
+    }
+    active = 0;
+    for (v = 0; v < g->n; v++) {
+      x = job->next[v] & ~job->seen[v];
+      job->next[v] = 0;
+      job->visit[v] = x;
+      if (x != 0) {
+        job->seen[v] |= x;
+        active = 1;
+        for (; x != 0; x &= x - 1) {
+          q = wlLowBit(x);
+          job->dist[(size_t)v * LANES + q] = (unsigned short)level;
+          job->ecc[q] = level;
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+static int relax(const wlgraph *g, const int *deg, const int *size,
+                 const int *comp, int *lo, int *hi, int *buf)
+/* Neighbours' eccentricities differ by at most 1, and a word with just one
+ * neighbour is 1 further than it from everything else - unless its
+ * component has only the two words.  Passes that on to each word's bounds,
+ * and returns how many words it settles, or -1 if it changes nothing. */
+{
+  const int *nbrs;
+  int u, i, n, was, settled = 0, changed = 0;
+
+  for (u = 0; u < g->n; u++) {
+    if (deg[u] == 0) {
+      continue;
+    }
+    was = lo[u] == hi[u];
+    n = wlAdjacent(g, u, buf, &nbrs);
+    for (i = 0; i < n; i++) {
+      if (lo[nbrs[i]] - 1 > lo[u]) {
+        lo[u] = lo[nbrs[i]] - 1;
+        changed = 1;
+      }
+      if (hi[nbrs[i]] + 1 < hi[u]) {
+        hi[u] = hi[nbrs[i]] + 1;
+        changed = 1;
+      }
+      if (deg[u] == 1 && size[comp[u]] > 2) {
+        if (lo[nbrs[i]] + 1 > lo[u]) {
+          lo[u] = lo[nbrs[i]] + 1;
+          changed = 1;
+        }
+      }
+      if (deg[nbrs[i]] == 1 && size[comp[u]] > 2) {
+        if (hi[nbrs[i]] - 1 < hi[u]) {
+          hi[u] = hi[nbrs[i]] - 1;
+          changed = 1;
+        }
+      }
+    }
+    settled += !was && lo[u] == hi[u];
+  }
+  return changed ? settled : -1;
+}
+
+static int tighten(const eccjob *job, int *lo, int *hi)
+/* updates every reached word's bounds from a job's searches, and returns
+ * how many words they settle */
+{
+  uint64_t x;
+  int v, q, d, e, was, settled = 0;
+
+  for (v = 0; v < job->g->n; v++) {
+    was = lo[v] == hi[v];
+    for (x = job->seen[v]; x != 0; x &= x - 1) {
+      q = wlLowBit(x);
+      d = job->dist[(size_t)v * LANES + q];
+      e = job->ecc[q];
+      if (d > lo[v]) {
+        lo[v] = d;
+      }
+      if (e - d > lo[v]) {
+        lo[v] = e - d;
+      }
+      if (e + d < hi[v]) {
+        hi[v] = e + d;
+      }
+    }
+    settled += !was && lo[v] == hi[v];
+  }
+  return settled;
+}
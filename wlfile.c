@@ -0,0 +1,331 @@
+/* Saving a dictionary, graphs and all, and loading it back.
+ * A saved dictionary is a header followed by each graph in turn: a record
+ * of its sizes, then its arrays exactly as they are held in memory, each
+ * padded to a multiple of 8 bytes.  Loading it maps the file read-only,
+ * with each graph's arrays pointed into the mapping - nothing is built or
+ * copied.  Nothing in the file is a pointer, so the mapping can live at any
+ * address, and every process that loads the same file shares one copy of
+ * its pages; the numbers are in the byte order of the machine that saved
+ * them.
+ * A file is saved under a temporary name and then renamed over the old
+ * one, so a process loading it sees either the old version or the new,
+ * never half of one, and a process still using the old one keeps its pages
+ * until it is done.
+ */
+#define _POSIX_C_SOURCE 200112L /* for fileno(), fsync() and mmap() */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "wlprivate.h"
+
+#define ALIGN(x) (((x) + 7) & ~(size_t)7)
+
+typedef struct header {
+  char magic[MAGICLEN];
+  int32_t maxlen;
+  int32_t nwords;
+  int32_t skipped;
+  int32_t ngraphs;
+} header;
+
+typedef struct record {
+  int32_t wlen;
+  int32_t n;
+  int32_t m; /* entries in adj */
+  int32_t tsize;
+  int32_t nlm;
+  int32_t hascomp;
+  int32_t nlabel; /* entries in label, or -1 without hub labels */
+  int32_t maxdeg;
+  int32_t ncode; /* bytes of code, or -1 if the graph isn't compacted */
+  int32_t pad;
+} record;
+
+static int   putBlock(FILE *file, const void *p, size_t size);
+static void *getBlock(char *image, size_t size, size_t *pos, size_t want);
+static int   checkGraph(const wlgraph *g);
+
+wlerr wlSave(const wldict *dict, const char *path)
+{
+  FILE *file;
+  char *tmp = (char *)malloc(strlen(path) + 32);
+  const wlgraph *g;
+  header h;
+  record r;
+  int i, ok;
+
+  if (tmp == NULL) {
+    return wl_nomem;
+  }
+  sprintf(tmp, "%s.%ld.tmp", path, (long)getpid());
+  if ((file = fopen(tmp, "wb")) == NULL) {
+    free(tmp);
+    return wl_nofile;
+  }
+  memset(&h, 0, sizeof(header));
+  memcpy(h.magic, MAGIC, MAGICLEN);
+  h.maxlen = dict->maxlen;
+  h.nwords = dict->nwords;
+  h.skipped = dict->skipped;
+  for (i = 0; i <= dict->maxlen; i++) {
+    h.ngraphs += dict->graphs[i] != NULL;
+  }
+  ok = putBlock(file, &h, sizeof(header));
+  for (i = 0; i <= dict->maxlen && ok; i++) {
+    if ((g = dict->graphs[i]) == NULL) {
+      continue;
+    }
+    memset(&r, 0, sizeof(record));
+    r.wlen = g->wlen;
+    r.n = g->n;
+    r.m = g->m;
+    r.maxdeg = g->maxdeg;
+    r.ncode = g->code != NULL ? (int32_t)g->cblock[(g->n + CBLOCK - 1) / CBLOCK]
+                              : -1;
+    r.tsize = g->tsize;
+    r.nlm = g->nlm;
+    r.hascomp = g->comp != NULL;
+    r.nlabel = g->lfirst != NULL ? g->lfirst[g->n] : -1;
+    ok = putBlock(file, &r, sizeof(record))
+      && putBlock(file, g->words, (size_t)g->n * (g->wlen + 1))
+      && (r.ncode >= 0
+      ||  (putBlock(file, g->first, sizeof(int) * ((size_t)g->n + 1))
+      &&   putBlock(file, g->adj, sizeof(int) * (size_t)r.m)))
+      && (r.ncode < 0
+      ||  (putBlock(file, g->cblock, sizeof(unsigned int)
+                    * ((size_t)(g->n + CBLOCK - 1) / CBLOCK + 1))
+      &&   putBlock(file, g->coff, sizeof(unsigned short) * (size_t)g->n)
+      &&   putBlock(file, g->code, (size_t)r.ncode)))
+      && putBlock(file, g->table, sizeof(int) * (size_t)g->tsize)
+      && (!r.hascomp || putBlock(file, g->comp, sizeof(int) * (size_t)g->n))
+      && putBlock(file, g->lm, sizeof(int) * (size_t)g->nlm)
+      && putBlock(file, g->lmdist,
+                  sizeof(unsigned short) * (size_t)g->n * g->nlm)
+      && (r.nlabel < 0
+      ||  (putBlock(file, g->lfirst, sizeof(int) * ((size_t)g->n + 1))
+      &&   putBlock(file, g->label, sizeof(uint32_t) * (size_t)r.nlabel)));
+  }
+  ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+  if (fclose(file) != 0 || !ok || rename(tmp, path) != 0) {
+    remove(tmp);
+    free(tmp);
+    return wl_nofile;
+  }
+  free(tmp);
+  return wl_ok;
+}
+
+static int putBlock(FILE *file, const void *p, size_t size)
+/* writes size bytes and then enough zeros to reach a multiple of 8 */
+{
+  static const char zeros[8];
+
+  return (size == 0 || fwrite(p, 1, size, file) == size)
+      && fwrite(zeros, 1, ALIGN(size) - size, file) == ALIGN(size) - size;
+}
+
+wlerr wlLoadImage(FILE *file, wldict **dict)
+/* Every size read from the file is checked against the file's length
+ * before anything is pointed at, so a damaged file is turned away.  A file
+ * that can't be mapped is read onto the heap instead. */
+{
+  wldict *d;
+  wlgraph *g;
+  header *h;
+  record *r;
+  char *image;
+  long size;
+  size_t pos = 0;
+  int i;
+  STAT(double t = wlTime());
+
+  if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0
+  ||  fseek(file, 0, SEEK_SET) != 0) {
+    return wl_nofile;
+  }
+  if ((d = (wldict *)calloc(1, sizeof(wldict))) == NULL) {
+    return wl_nomem;
+  }
+  image = size > 0 ? (char *)mmap(NULL, size, PROT_READ, MAP_SHARED,
+                                  fileno(file), 0)
+                   : (char *)MAP_FAILED;
+  if (image != (char *)MAP_FAILED) {
+    d->mapped = 1;
+  }
+  else if ((image = (char *)malloc(size + 1)) == NULL) {
+    free(d);
+    return wl_nomem;
+  }
+  else if (fread(image, 1, size, file) != (size_t)size) {
+    free(image);
+    free(d);
+    return wl_badfile;
+  }
+  d->image = image;
+  d->imagesize = size;
+  if ((h = (header *)getBlock(image, size, &pos, sizeof(header))) == NULL
+  ||  memcmp(h->magic, MAGIC, MAGICLEN) != 0
+  ||  h->maxlen < 0 || h->ngraphs < 0 || h->ngraphs > h->maxlen + 1) {
+    wlFree(d);
+    return wl_badfile;
+  }
+  d->maxlen = h->maxlen;
+  d->nwords = h->nwords;
+  d->skipped = h->skipped;
+  if ((d->graphs = (wlgraph **)calloc(d->maxlen + 1,
+                                      sizeof(wlgraph *))) == NULL) {
+    wlFree(d);
+    return wl_nomem;
+  }
+  for (i = 0; i < h->ngraphs; i++) {
+    if ((r = (record *)getBlock(image, size, &pos, sizeof(record))) == NULL
+    ||  r->wlen < 1 || r->wlen > d->maxlen || d->graphs[r->wlen] != NULL
+    ||  r->n < 1 || r->m < 0 || r->tsize < 2 * r->n
+    ||  (r->tsize & (r->tsize - 1)) != 0
+    ||  r->nlm < 0 || r->nlm > WL_MAXLANDMARKS || r->nlabel < -1
+    ||  r->maxdeg < 0 || r->maxdeg >= r->n || r->ncode < -1) {
+      wlFree(d);
+      return wl_badfile;
+    }
+    if ((g = (wlgraph *)calloc(1, sizeof(wlgraph))) == NULL) {
+      wlFree(d);
+      return wl_nomem;
+    }
+    d->graphs[r->wlen] = g;
+    g->dict = d;
+    g->wlen = r->wlen;
+    g->kern = wlKernels(g->wlen);
+    g->n = r->n;
+    g->m = r->m;
+    g->maxdeg = r->maxdeg;
+    g->tsize = r->tsize;
+    g->nlm = r->nlm;
+    g->words = (char *)getBlock(image, size, &pos,
+                                (size_t)g->n * (g->wlen + 1));
+    if (r->ncode < 0) {
+      g->first = (int *)getBlock(image, size, &pos,
+                                 sizeof(int) * ((size_t)g->n + 1));
+      g->adj = (int *)getBlock(image, size, &pos,
+                               sizeof(int) * (size_t)r->m);
+    }
+    else {
+      g->cblock = (unsigned int *)getBlock(image, size, &pos,
+                                           sizeof(unsigned int)
+                                           * ((size_t)(g->n + CBLOCK - 1)
+                                              / CBLOCK + 1));
+      g->coff = (unsigned short *)getBlock(image, size, &pos,
+                                           sizeof(unsigned short)
+                                           * (size_t)g->n);
+      g->code = (unsigned char *)getBlock(image, size, &pos,
+                                          (size_t)r->ncode);
+      /* the table comes next, so reading a little past the code is safe */
+    }
+    g->table = (int *)getBlock(image, size, &pos,
+                               sizeof(int) * (size_t)g->tsize);
+    if (r->hascomp) {
+      g->comp = (int *)getBlock(image, size, &pos, sizeof(int) * (size_t)g->n);
+    }
+    g->lm = (int *)getBlock(image, size, &pos, sizeof(int) * (size_t)g->nlm);
+    g->lmdist = (unsigned short *)getBlock(image, size, &pos,
+                                           sizeof(unsigned short)
+                                           * (size_t)g->n * g->nlm);
+    if (r->nlabel >= 0) {
+      g->lfirst = (int *)getBlock(image, size, &pos,
+                                  sizeof(int) * ((size_t)g->n + 1));
+      g->label = (uint32_t *)getBlock(image, size, &pos,
+                                      sizeof(uint32_t) * (size_t)r->nlabel);
+    }
+    if (g->words == NULL
+    ||  (r->ncode < 0 && (g->first == NULL || g->adj == NULL
+                          || g->first[g->n] != r->m))
+    ||  (r->ncode >= 0 && (g->cblock == NULL || g->coff == NULL
+                           || g->code == NULL
+                           || !wlCheckCode(g, r->ncode)))
+    ||  g->table == NULL || (r->hascomp && g->comp == NULL)
+    ||  g->lm == NULL || g->lmdist == NULL
+    ||  (r->nlabel >= 0 && (g->lfirst == NULL || g->label == NULL
+                            || g->lfirst[g->n] != r->nlabel))
+    ||  !checkGraph(g)) {
+      wlFree(d);
+      return wl_badfile;
+    }
+  }
+  STAT(d->time[wl_load] = wlTime() - t);
+  STAT(d->bytes = d->mapped ? 0 : size); /* mapped pages aren't the heap's */
+  *dict = d;
+  return wl_ok;
+}
+
+void wlFreeImage(wldict *dict)
+{
+  if (dict->mapped) {
+    munmap(dict->image, dict->imagesize);
+  }
+  else {
+    free(dict->image);
+  }
+  dict->image = NULL;
+}
+
+static void *getBlock(char *image, size_t size, size_t *pos, size_t want)
+/* the next block of want bytes, or NULL if the file is too short */
+{
+  void *p = image + *pos;
+
+  if (size - *pos < ALIGN(want)) {
+    return NULL;
+  }
+  *pos += ALIGN(want);
+  return p;
+}
+
+static int checkGraph(const wlgraph *g)
+/* every word number in g is in range, so no search can be led astray */
+{
+  size_t k;
+  int i, j;
+
+  for (i = 0; i < g->n; i++) {
+    if ((g->first != NULL
+         && (g->first[i] < 0 || g->first[i] > g->first[i + 1]
+             || g->first[i + 1] - g->first[i] > g->maxdeg))
+    ||  g->words[(size_t)i * (g->wlen + 1) + g->wlen] != '\0'
+    ||  (g->comp != NULL && (g->comp[i] < 0 || g->comp[i] >= g->n))) {
+      return 0;
+    }
+  }
+  for (i = 0; g->first != NULL && i < g->first[g->n]; i++) {
+    if (g->adj[i] < 0 || g->adj[i] >= g->n) {
+      return 0;
+    }
+  }
+  for (i = 0; i < g->tsize; i++) {
+    if (g->table[i] < 0 || g->table[i] > g->n) {
+      return 0;
+    }
+  }
+  for (i = 0; i < g->nlm; i++) {
+    if (g->lm[i] < 0 || g->lm[i] >= g->n) {
+      return 0;
+    }
+  }
+  for (k = 0; k < (size_t)g->n * g->nlm; k++) {
+    if (g->lmdist[k] >= g->n && g->lmdist[k] < CAPPED) {
+      return 0; /* wlSearchNew() sizes the A* buckets for bounds below n */
+    }
+  }
+  for (i = 0; g->lfirst != NULL && i < g->n; i++) {
+    if (g->lfirst[i] < 0 || g->lfirst[i] > g->lfirst[i + 1]) {
+      return 0;
+    }
+    for (j = g->lfirst[i]; j < g->lfirst[i + 1]; j++) {
+      if (HUB(g->label[j]) >= g->n
+      ||  (j > g->lfirst[i] && HUB(g->label[j]) <= HUB(g->label[j - 1]))) {
+        return 0; /* wlLabelDist() merges labels sorted by hub */
+      }
+    }
+  }
+  return 1;
+}
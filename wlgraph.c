@@ -0,0 +1,743 @@
+/* Loading a dictionary and building its graphs.
+ * The file is read once, and its alphabetic words are sorted by length into
+ * one block of words per length, numbered in dictionary order.  Each
+ * length's graph - which words are one letter apart - is then built by
+ * sorting "wildcard keys": each word with one letter blanked out, so that
+ * words one letter apart end up next to each other.  Graphs for different
+ * lengths are built at the same time, and a large one is itself split
+ * between threads.
+ * A hash table on each graph finds a word's number in O(1).
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "wlprivate.h"
+
+typedef struct pending {
+  char *buf; /* words of one length, each followed by a NUL */
+  int n;
+  int cap; /* buf has room for cap words */
+} pending;
+
+typedef struct builder {
+  wlgraph *g;
+  int nthreads;
+  int *perm; /* wlen blocks of n ids, block p sorted on the key without p */
+  int *start; /* bucket starts within each block, by first key letter */
+  int *deg; /* nthreads blocks of n per-thread neighbour counts */
+  int *off; /* nthreads blocks of n per-thread write positions in adj */
+} builder;
+
+typedef struct buildjob {
+  builder *b;
+  int tid;
+  int *tmp; /* scratch space for the radix sort */
+  int *edges; /* pairs of word numbers found by this thread */
+  long nedges;
+  long cap; /* edges has room for cap pairs */
+  wlerr err;
+} buildjob;
+
+typedef struct partjob {
+  wldict *d;
+  wlgraphtask task;
+  int arg;
+  int *order; /* lengths to work on, largest graph first */
+  int nparts;
+  int worker;
+  int nworkers;
+  int nthreads; /* threads for each graph */
+  wlerr err;
+} partjob;
+
+static wlerr addWord(wldict *d, pending **p, int *plen, char *s, int len,
+                     int wlen);
+static int   checkWord(char *s);
+static void  lowerCase(char *s);
+static void *eachPart(void *arg);
+static wlerr buildPart(wlgraph *g, int nthreads, int arg);
+static wlerr buildGraph(wlgraph *g, int nthreads);
+static void *bucketKeys(void *arg);
+static void *sortKeys(void *arg);
+static void *placeEdges(void *arg);
+static void *sortNeighbours(void *arg);
+static int   keyLetter(const char *word, int p, int d);
+static int   addEdge(buildjob *job, int u, int v);
+static void  freeGraph(wlgraph *g);
+
+const char *wlError(wlerr err)
+{
+  switch (err) {
+    case wl_ok:       return "no error";
+    case wl_nofile:   return "failed to open file - check name and directory";
+    case wl_nomem:    return "out of memory";
+    case wl_badlen:   return "there are no words of this length";
+    case wl_notfound: return "word not found in list";
+    case wl_noladder: return "no ladder possible between these words";
+    case wl_badarg:   return "argument out of range";
+    case wl_badfile:  return "saved dictionary is damaged or out of date";
+  }
+  return "unknown error";
+}
+
+wlerr wlLoad(const char *path, int wlen, int nthreads, wldict **dict)
+{
+  FILE *file = fopen(path, "r");
+  wldict *d;
+  pending *p = NULL;
+  char *line = NULL, *tmp;
+  char magic[MAGICLEN];
+  int plen = 0, len = 0, cap = 0, c, i;
+  wlerr err = wl_ok;
+  STAT(double t = wlTime());
+
+  if (file == NULL) {
+    return wl_nofile;
+  }
+  if (fread(magic, 1, MAGICLEN, file) == MAGICLEN
+  &&  memcmp(magic, MAGIC, MAGICLEN - 1) == 0) { /* of any version */
+    err = wlLoadImage(file, dict);
+    fclose(file);
+    return err;
+  }
+  rewind(file);
+  if ((d = (wldict *)calloc(1, sizeof(wldict))) == NULL) {
+    fclose(file);
+    return wl_nomem;
+  }
+  while (err == wl_ok && (c = getc(file)) != EOF) {
+    if (c == '\n') {
+      err = addWord(d, &p, &plen, line, len, wlen);
+      len = 0;
+    }
+    else {
+      if (len + 1 >= cap) {
+        cap = cap == 0 ? 64 : cap * 2;
+        if ((tmp = (char *)realloc(line, cap)) == NULL) {
+          err = wl_nomem;
+          break;
+        }
+        line = tmp;
+      }
+      line[len++] = (char)c;
+    }
+  }
+  if (err == wl_ok && len > 0) {
+    err = addWord(d, &p, &plen, line, len, wlen); /* no final newline */
+  }
+  fclose(file);
+  free(line);
+
+  /* each length's block of words becomes its graph */
+  if (err == wl_ok) {
+    d->graphs = (wlgraph **)calloc(d->maxlen + 1, sizeof(wlgraph *));
+    if (d->graphs == NULL) {
+      err = wl_nomem;
+    }
+  }
+  for (i = 0; i < plen; i++) {
+    if (err == wl_ok && p[i].n > 0) {
+      if ((d->graphs[i] = (wlgraph *)calloc(1, sizeof(wlgraph))) == NULL) {
+        err = wl_nomem;
+      }
+      else {
+        d->graphs[i]->dict = d;
+        d->graphs[i]->wlen = i;
+        d->graphs[i]->kern = wlKernels(i);
+        d->graphs[i]->n = p[i].n;
+        d->graphs[i]->words = p[i].buf;
+        p[i].buf = NULL;
+      }
+    }
+    free(p[i].buf);
+  }
+  free(p);
+  STAT(d->time[wl_load] = wlTime() - t);
+
+  if (err == wl_ok) {
+    STAT(t = wlTime());
+    err = wlEachGraph(d, buildPart, 0, wlThreadCount(nthreads));
+    STAT(d->time[wl_build] = wlTime() - t);
+  }
+  if (err != wl_ok) {
+    wlFree(d);
+    return err;
+  }
+#ifdef WL_STATS
+  for (i = 0; i <= d->maxlen; i++) {
+    if (d->graphs[i] != NULL) {
+      d->bytes += (long)d->graphs[i]->n * (i + 1)
+        + sizeof(int) * ((long)d->graphs[i]->n + 1
+                         + d->graphs[i]->m
+                         + d->graphs[i]->tsize);
+    }
+  }
+#endif
+  *dict = d;
+  return wl_ok;
+}
+
+static wlerr addWord(wldict *d, pending **p, int *plen, char *s, int len,
+                     int wlen)
+/* files each alphabetic word in the block for its length - p grows to
+ * cover the longest word seen so far */
+{
+  pending *tmp;
+  char *buf;
+  int i;
+
+  if (len == 0) {
+    return wl_ok;
+  }
+  s[len] = '\0';
+  if (!checkWord(s)) {
+    d->skipped++;
+    return wl_ok;
+  }
+  d->nwords++;
+  lowerCase(s);
+  if (len > d->maxlen) {
+    d->maxlen = len;
+  }
+  if (wlen != 0 && len != wlen) {
+    return wl_ok;
+  }
+  if (len >= *plen) {
+    if ((tmp = (pending *)realloc(*p, sizeof(pending) * (len + 1))) == NULL) {
+      return wl_nomem;
+    }
+    for (i = *plen; i <= len; i++) {
+      tmp[i].buf = NULL;
+      tmp[i].n = tmp[i].cap = 0;
+    }
+    *p = tmp;
+    *plen = len + 1;
+  }
+  tmp = *p + len;
+  if (tmp->n == tmp->cap) {
+    tmp->cap = tmp->cap == 0 ? 256 : tmp->cap * 2;
+    buf = (char *)realloc(tmp->buf, (size_t)tmp->cap * (len + 1));
+    if (buf == NULL) {
+      return wl_nomem;
+    }
+    tmp->buf = buf;
+  }
+  memcpy(tmp->buf + (size_t)tmp->n * (len + 1), s, len + 1);
+  tmp->n++;
+  return wl_ok;
+}
+
+static int checkWord(char *s)
+{
+  int i;
+
+  for (i = 0; s[i]; i++)  {
+    if (!isalpha((unsigned char)s[i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void lowerCase(char *s)
+{
+  int i;
+
+  for (i = 0; s[i]; i++)  {
+    s[i] = tolower((unsigned char)s[i]);
+  }
+}
+
+void wlFree(wldict *dict)
+{
+  int i;
+
+  if (dict == NULL) {
+    return;
+  }
+  if (dict->graphs != NULL) {
+    for (i = 0; i <= dict->maxlen; i++) {
+      freeGraph(dict->graphs[i]);
+    }
+  }
+  free(dict->graphs);
+  wlFreeImage(dict);
+  free(dict);
+}
+
+static void freeGraph(wlgraph *g)
+/* a saved dictionary's graphs point into its image, which is freed whole */
+{
+  if (g != NULL) {
+    if (g->dict->image == NULL) {
+      free(g->words);
+      free(g->first);
+      free(g->adj);
+      free(g->code);
+      free(g->cblock);
+      free(g->coff);
+      free(g->table);
+      free(g->comp);
+      free(g->lm);
+      free(g->lmdist);
+      free(g->lfirst);
+      free(g->label);
+    }
+    free(g);
+  }
+}
+
+int wlWordCount(const wldict *dict)
+{
+  return dict->nwords;
+}
+
+int wlSkipped(const wldict *dict)
+{
+  return dict->skipped;
+}
+
+int wlMaxLen(const wldict *dict)
+{
+  return dict->maxlen;
+}
+
+const wlgraph *wlGraph(const wldict *dict, int wlen)
+{
+  if (wlen < 1 || wlen > dict->maxlen) {
+    return NULL;
+  }
+  return dict->graphs[wlen];
+}
+
+int wlSize(const wlgraph *g)
+{
+  return g->n;
+}
+
+int wlLength(const wlgraph *g)
+{
+  return g->wlen;
+}
+
+const char *wlWord(const wlgraph *g, int id)
+{
+  if (id < 0 || id >= g->n) {
+    return NULL;
+  }
+  return WORD(g, id);
+}
+
+int wlFind(const wlgraph *g, const char *word)
+{
+  unsigned long h;
+  int id;
+
+  if ((int)strlen(word) != g->wlen) {
+    return -1;
+  }
+  h = g->kern->hash(word, g->wlen) & (g->tsize - 1);
+  while ((id = g->table[h] - 1) != -1) {
+    if (g->kern->same(WORD(g, id), word, g->wlen)) {
+      return id;
+    }
+    h = (h + 1) & (g->tsize - 1);
+  }
+  return -1;
+}
+
+int wlNeighbours(const wlgraph *g, int id, int *buf, const int **nbrs)
+{
+  if (id < 0 || id >= g->n) {
+    *nbrs = NULL;
+    return 0;
+  }
+  return wlAdjacent(g, id, buf, nbrs);
+}
+
+int wlMaxDegree(const wlgraph *g)
+{
+  return g->maxdeg;
+}
+
+int wlThreadCount(int nthreads)
+{
+  char *env = getenv("WL_THREADS");
+  long n = nthreads;
+
+  if (n <= 0 && env != NULL) {
+    n = atoi(env);
+  }
+  if (n <= 0) {
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (n < 1) {
+    n = 1;
+  }
+  if (n > MAXTHREADS) {
+    n = MAXTHREADS;
+  }
+  return (int)n;
+}
+
+void wlRunThreads(wltask task, void *jobs, size_t jobsize, int njobs)
+/* The calling thread does the first job itself.  A job whose thread can't
+ * be started is done here too, after the first. */
+{
+  pthread_t threads[MAXTHREADS];
+  int started[MAXTHREADS];
+  int t;
+
+  for (t = 1; t < njobs; t++) {
+    started[t] = pthread_create(&threads[t], NULL, task,
+                                (char *)jobs + t * jobsize) == 0;
+  }
+  task(jobs);
+  for (t = 1; t < njobs; t++) {
+    if (started[t]) {
+      pthread_join(threads[t], NULL);
+    }
+    else {
+      task((char *)jobs + t * jobsize);
+    }
+  }
+}
+
+double wlTime(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+wlerr wlEachGraph(wldict *d, wlgraphtask task, int arg, int nthreads)
+/* The graphs are shared out between up to nthreads workers, biggest first,
+ * and any threads left over are handed on to the task for each graph. */
+{
+  partjob jobs[MAXTHREADS];
+  int *lens;
+  int nparts = 0, nworkers, i, j, tmp;
+  wlerr err = wl_ok;
+
+  if ((lens = (int *)malloc(sizeof(int) * (d->maxlen + 1))) == NULL) {
+    return wl_nomem;
+  }
+  for (i = 0; i <= d->maxlen; i++) {
+    if (d->graphs[i] != NULL) {
+      lens[nparts++] = i;
+    }
+  }
+  for (i = 1; i < nparts; i++) {
+    tmp = lens[i];
+    for (j = i - 1; j >= 0 && d->graphs[lens[j]]->n < d->graphs[tmp]->n; j--) {
+      lens[j + 1] = lens[j];
+    }
+    lens[j + 1] = tmp;
+  }
+  nworkers = nparts < nthreads ? nparts : nthreads;
+  for (i = 0; i < nworkers; i++) {
+    jobs[i].d = d;
+    jobs[i].task = task;
+    jobs[i].arg = arg;
+    jobs[i].order = lens;
+    jobs[i].nparts = nparts;
+    jobs[i].worker = i;
+    jobs[i].nworkers = nworkers;
+    jobs[i].nthreads = nthreads / nworkers;
+    jobs[i].err = wl_ok;
+  }
+  if (nworkers > 0) {
+    wlRunThreads(eachPart, jobs, sizeof(partjob), nworkers);
+  }
+  for (i = 0; i < nworkers; i++) {
+    if (jobs[i].err != wl_ok) {
+      err = jobs[i].err;
+    }
+  }
+  free(lens);
+  return err;
+}
+
+static void *eachPart(void *arg)
+{
+  partjob *job = (partjob *)arg;
+  int i;
+
+  for (i = job->worker; i < job->nparts && job->err == wl_ok;
+       i += job->nworkers) {
+    job->err = job->task(job->d->graphs[job->order[i]], job->nthreads,
+                         job->arg);
+  }
+  return NULL;
+}
+
+static wlerr buildPart(wlgraph *g, int nthreads, int arg)
+{
+  wlerr err = buildGraph(g, nthreads);
+
+  (void)arg;
+  return err == wl_ok ? wlBuildTable(g) : err;
+}
+
+wlerr wlBuildTable(wlgraph *g)
+/* open addressing; a repeated word keeps the number it was first given */
+{
+  unsigned long h;
+  int id, other;
+
+  g->tsize = 2;
+  while (g->tsize < 2 * g->n) {
+    g->tsize *= 2;
+  }
+  if ((g->table = (int *)calloc(g->tsize, sizeof(int))) == NULL) {
+    return wl_nomem;
+  }
+  for (id = 0; id < g->n; id++) {
+    h = g->kern->hash(WORD(g, id), g->wlen) & (g->tsize - 1);
+    while ((other = g->table[h] - 1) != -1
+    &&     !g->kern->same(WORD(g, other), WORD(g, id), g->wlen)) {
+      h = (h + 1) & (g->tsize - 1);
+    }
+    if (other == -1) {
+      g->table[h] = id + 1;
+    }
+  }
+  return wl_ok;
+}
+
+static wlerr buildGraph(wlgraph *g, int nthreads)
+/* Two words are neighbours if they have the same key once the same letter
+ * is blanked out of each.  Every (word, blanked position) key is generated,
+ * then radix sorted: the blanked position and the key's first letter are
+ * the top digits and split the work into wlen * ALPHA independent buckets,
+ * which the threads sort and scan for runs of equal keys.  Each thread keeps
+ * its own edges and neighbour counts, so they can be merged into one
+ * adjacency array with no locking - every thread is given its own slots. */
+{
+  builder b;
+  buildjob jobs[MAXTHREADS];
+  int i, t, u, pos;
+  wlerr err = wl_ok;
+
+  b.g = g;
+  b.nthreads = nthreads;
+  b.perm = (int *)malloc(sizeof(int) * g->wlen * g->n);
+  b.start = (int *)malloc(sizeof(int) * g->wlen * (ALPHA + 1));
+  b.deg = (int *)calloc((size_t)nthreads * g->n, sizeof(int));
+  b.off = (int *)malloc(sizeof(int) * nthreads * g->n);
+  g->first = (int *)malloc(sizeof(int) * (g->n + 1));
+  if (b.perm == NULL || b.start == NULL || b.deg == NULL || b.off == NULL
+  ||  g->first == NULL) {
+    err = wl_nomem;
+  }
+  for (t = 0; t < nthreads; t++) {
+    jobs[t].b = &b;
+    jobs[t].tid = t;
+    jobs[t].tmp = (int *)malloc(sizeof(int) * g->n);
+    jobs[t].edges = NULL;
+    jobs[t].nedges = jobs[t].cap = 0;
+    jobs[t].err = wl_ok;
+    if (jobs[t].tmp == NULL) {
+      err = wl_nomem;
+    }
+  }
+
+  if (err == wl_ok) {
+    wlRunThreads(bucketKeys, jobs, sizeof(buildjob), nthreads);
+    wlRunThreads(sortKeys, jobs, sizeof(buildjob), nthreads);
+    for (t = 0; t < nthreads; t++) {
+      if (jobs[t].err != wl_ok) {
+        err = jobs[t].err;
+      }
+    }
+  }
+  if (err == wl_ok) {
+    /* each word's slots in adj are split between the threads in order */
+    g->first[0] = 0;
+    for (u = 0; u < g->n; u++) {
+      pos = g->first[u];
+      for (t = 0; t < nthreads; t++) {
+        b.off[t * g->n + u] = pos;
+        pos += b.deg[t * g->n + u];
+      }
+      g->first[u + 1] = pos;
+      if (pos - g->first[u] > g->maxdeg) {
+        g->maxdeg = pos - g->first[u];
+      }
+    }
+    g->m = g->first[g->n];
+    if ((g->adj = (int *)malloc(sizeof(int) * (g->first[g->n] + 1))) == NULL) {
+      err = wl_nomem;
+    }
+  }
+  if (err == wl_ok) {
+    wlRunThreads(placeEdges, jobs, sizeof(buildjob), nthreads);
+    wlRunThreads(sortNeighbours, jobs, sizeof(buildjob), nthreads);
+  }
+
+  for (i = 0; i < nthreads; i++) {
+    free(jobs[i].tmp);
+    free(jobs[i].edges);
+  }
+  free(b.perm);
+  free(b.start);
+  free(b.deg);
+  free(b.off);
+  return err;
+}
+
+static int keyLetter(const char *word, int p, int d)
+/* letter d of word's key when position p is blanked out, as 0 to ALPHA-1 */
+{
+  return word[d < p ? d : d + 1] - 'a';
+}
+
+static void *bucketKeys(void *arg)
+/* counting sort of every word on its key's first letter, one blanked
+ * position at a time */
+{
+  buildjob *job = (buildjob *)arg;
+  wlgraph *g = job->b->g;
+  int *start, *perm;
+  int pos[ALPHA];
+  int p, i, c;
+
+  for (p = job->tid; p < g->wlen; p += job->b->nthreads) {
+    start = job->b->start + p * (ALPHA + 1);
+    perm = job->b->perm + p * g->n;
+    for (c = 0; c <= ALPHA; c++) {
+      start[c] = 0;
+    }
+    for (i = 0; i < g->n; i++) {
+      c = g->wlen > 1 ? keyLetter(WORD(g, i), p, 0) : 0;
+      start[c + 1]++;
+    }
+    for (c = 0; c < ALPHA; c++) {
+      start[c + 1] += start[c];
+      pos[c] = start[c];
+    }
+    for (i = 0; i < g->n; i++) {
+      c = g->wlen > 1 ? keyLetter(WORD(g, i), p, 0) : 0;
+      perm[pos[c]++] = i;
+    }
+  }
+  return NULL;
+}
+
+static void *sortKeys(void *arg)
+/* LSD radix sorts each bucket on the rest of its key, then links every
+ * word in a run of equal keys to every other word in that run */
+{
+  buildjob *job = (buildjob *)arg;
+  wlgraph *g = job->b->g;
+  int cnt[ALPHA + 1];
+  int *ids;
+  int k, p, d, m, i, j, x, y, c;
+
+  for (k = job->tid; k < g->wlen * ALPHA && job->err == wl_ok;
+       k += job->b->nthreads) {
+    p = k / ALPHA;
+    c = k % ALPHA;
+    ids = job->b->perm + p * g->n + job->b->start[p * (ALPHA + 1) + c];
+    m = job->b->start[p * (ALPHA + 1) + c + 1]
+      - job->b->start[p * (ALPHA + 1) + c];
+    if (m < 2) {
+      continue;
+    }
+    for (d = g->wlen - 2; d >= 1; d--) {
+      for (c = 0; c <= ALPHA; c++) {
+        cnt[c] = 0;
+      }
+      for (i = 0; i < m; i++) {
+        cnt[keyLetter(WORD(g, ids[i]), p, d) + 1]++;
+      }
+      for (c = 0; c < ALPHA; c++) {
+        cnt[c + 1] += cnt[c];
+      }
+      for (i = 0; i < m; i++) {
+        job->tmp[cnt[keyLetter(WORD(g, ids[i]), p, d)]++] = ids[i];
+      }
+      memcpy(ids, job->tmp, sizeof(int) * m);
+    }
+    for (i = 0; i < m; i = j) {
+      for (j = i + 1; j < m; j++) {
+        /* the keys match if the words differ in no letter but p */
+        if (g->kern->hamming(WORD(g, ids[i]), WORD(g, ids[j]), g->wlen)
+        !=  (WORD(g, ids[i])[p] != WORD(g, ids[j])[p])) {
+          break; /* end of this run of equal keys */
+        }
+      }
+      for (x = i; x < j; x++) {
+        for (y = x + 1; y < j; y++) {
+          /* the blanked letter differs unless the dictionary repeats a word */
+          if (WORD(g, ids[x])[p] != WORD(g, ids[y])[p]
+          &&  (!addEdge(job, ids[x], ids[y])
+          ||   !addEdge(job, ids[y], ids[x]))) {
+            return NULL;
+          }
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+static int addEdge(buildjob *job, int u, int v)
+/* returns 0, and flags the job, if there is no room for the edge */
+{
+  int *edges;
+
+  if (job->nedges == job->cap) {
+    job->cap = job->cap == 0 ? 1024 : job->cap * 2;
+    edges = (int *)realloc(job->edges, sizeof(int) * 2 * job->cap);
+    if (edges == NULL) {
+      job->err = wl_nomem;
+      return 0;
+    }
+    job->edges = edges;
+  }
+  job->edges[2 * job->nedges] = u;
+  job->edges[2 * job->nedges + 1] = v;
+  job->nedges++;
+  job->b->deg[job->tid * job->b->g->n + u]++;
+  return 1;
+}
+
+static void *placeEdges(void *arg)
+{
+  buildjob *job = (buildjob *)arg;
+  int *off = job->b->off + job->tid * job->b->g->n;
+  long e;
+
+  for (e = 0; e < job->nedges; e++) {
+    job->b->g->adj[off[job->edges[2 * e]]++] = job->edges[2 * e + 1];
+  }
+  return NULL;
+}
+
+static void *sortNeighbours(void *arg)
+/* insertion sort - lists are short, and sorting keeps the search order (and
+ * so the ladder found) the same as scanning the word list would */
+{
+  buildjob *job = (buildjob *)arg;
+  wlgraph *g = job->b->g;
+  int u, i, j, v;
+  int from = (int)((long)g->n * job->tid / job->b->nthreads);
+  int to = (int)((long)g->n * (job->tid + 1) / job->b->nthreads);
+
+  for (u = from; u < to; u++) {
+    for (i = g->first[u] + 1; i < g->first[u + 1]; i++) {
+      v = g->adj[i];
+      for (j = i - 1; j >= g->first[u] && g->adj[j] > v; j--) {
+        g->adj[j + 1] = g->adj[j];
+      }
+      g->adj[j + 1] = v;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,215 @@
+/* Landmarks - distance estimates without searching.
+ * A few words of each length are chosen as landmarks, and every word's
+ * distance from each of them is worked out by a BFS.  Since the distance
+ * between two words can't be less than the difference in their distances
+ * from any landmark, nor more than the sum, these give lower and upper
+ * bounds on any ladder straight away (the triangle inequality).  The lower
+ * bound also steers the A* search in wlsearch.c towards its end.
+ * Landmarks are chosen one at a time, each as far as possible from those
+ * already chosen, so that they sit out on the edges of the graph where the
+ * bounds they give are tightest.  Every word is also given the number of its
+ * connected component, so that words with no ladder between them are found
+ * without searching at all.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "wlprivate.h"
+
+static wlerr indexGraph(wlgraph *g, int nthreads, int k);
+static int   distances(const wlgraph *g, int from, unsigned short *dist,
+                       int stride, int *queue, int *buf);
+
+wlerr wlLandmarks(wldict *dict, int k, int nthreads)
+/* each worker indexes whole graphs, as the landmarks within one graph have
+ * to be chosen one after another */
+{
+  wlerr err;
+  STAT(int i);
+
+  if (k < 1 || k > WL_MAXLANDMARKS || dict->image != NULL) {
+    return wl_badarg;
+  }
+  err = wlEachGraph(dict, indexGraph, k, wlThreadCount(nthreads));
+#ifdef WL_STATS
+  for (i = 0; i <= dict->maxlen; i++) {
+    if (dict->graphs[i] != NULL) {
+      dict->bytes += sizeof(int) * ((long)dict->graphs[i]->n
+                                    + dict->graphs[i]->nlm)
+        + sizeof(unsigned short) * (long)dict->graphs[i]->n
+          * dict->graphs[i]->nlm;
+    }
+  }
+#endif
+  return err;
+}
+
+static wlerr indexGraph(wlgraph *g, int nthreads, int k)
+/* The landmarks all go in the largest component, where the long searches
+ * are.  The first is the word furthest from an arbitrary word there, and
+ * each after that the word whose nearest landmark is furthest away. */
+{
+  int *queue = (int *)malloc(sizeof(int) * (g->n + 1));
+  int *buf = (int *)malloc(sizeof(int) * (g->maxdeg + 1));
+  unsigned short *near = (unsigned short *)malloc(sizeof(unsigned short)
+                                                  * (g->n + 1));
+  int big, v, i, best;
+
+  (void)nthreads;
+
+  free(g->comp);
+  free(g->lm);
+  free(g->lmdist);
+  g->nlm = 0;
+  g->comp = (int *)malloc(sizeof(int) * (g->n + 1));
+  g->lm = (int *)malloc(sizeof(int) * k);
+  g->lmdist = (unsigned short *)malloc(sizeof(unsigned short) * k
+                                       * ((size_t)g->n + 1));
+  if (queue == NULL || buf == NULL || near == NULL || g->comp == NULL
+  ||  g->lm == NULL || g->lmdist == NULL) {
+    free(queue);
+    free(buf);
+    free(near);
+    return wl_nomem;
+  }
+  big = wlComponents(g, g->comp, queue, buf);
+  for (v = 0; g->comp[v] != big; v++)
+    ;
+  g->lm[0] = distances(g, v, near, 1, queue, buf);
+  for (i = 0; i < k; i++) {
+    distances(g, g->lm[i], g->lmdist + i, k, queue, buf);
+    best = -1;
+    for (v = 0; v < g->n; v++) {
+      if (g->lmdist[(size_t)v * k + i] < near[v] || i == 0) {
+        near[v] = g->lmdist[(size_t)v * k + i];
+      }
+      if (near[v] != UNREACHED && (best == -1 || near[v] > near[best])) {
+        best = v;
+      }
+    }
+    if (i + 1 < k) {
+      g->lm[i + 1] = best;
+    }
+  }
+  g->nlm = k;
+  free(queue);
+  free(buf);
+  free(near);
+  return wl_ok;
+}
+
+int wlComponents(const wlgraph *g, int *comp, int *queue, int *buf)
+/* numbers each word's component, and returns the largest one's number */
+{
+  const int *nbrs;
+  int c = 0, big = 0, bigsize = 0, front, back, v, i, deg;
+
+  for (v = 0; v < g->n; v++) {
+    comp[v] = -1;
+  }
+  for (v = 0; v < g->n; v++) {
+    if (comp[v] != -1) {
+      continue;
+    }
+    comp[v] = c;
+    queue[0] = v;
+    for (front = 0, back = 1; front < back; front++) {
+      deg = wlAdjacent(g, queue[front], buf, &nbrs);
+      for (i = 0; i < deg; i++) {
+        if (comp[nbrs[i]] == -1) {
+          comp[nbrs[i]] = c;
+          queue[back++] = nbrs[i];
+        }
+      }
+    }
+    if (back > bigsize) {
+      bigsize = back;
+      big = c;
+    }
+    c++;
+  }
+  return big;
+}
+
+static int distances(const wlgraph *g, int from, unsigned short *dist,
+                     int stride, int *queue, int *buf)
+/* BFS from word from, leaving each word's distance at dist[word * stride]
+ * (UNREACHED if it isn't connected) and returning the last word reached.
+ * Longer distances than a short can hold are left at CAPPED, and not used. */
+{
+  const int *nbrs;
+  int front, back, u, v, i, deg;
+
+  for (v = 0; v < g->n; v++) {
+    dist[(size_t)v * stride] = UNREACHED;
+  }
+  dist[(size_t)from * stride] = 0;
+  queue[0] = from;
+  for (front = 0, back = 1; front < back; front++) {
+    u = queue[front];
+    deg = wlAdjacent(g, u, buf, &nbrs);
+    for (i = 0; i < deg; i++) {
+      v = nbrs[i];
+      if (dist[(size_t)v * stride] == UNREACHED) {
+        dist[(size_t)v * stride] = dist[(size_t)u * stride] < CAPPED
+          ? dist[(size_t)u * stride] + 1 : CAPPED;
+        queue[back++] = v;
+      }
+    }
+  }
+  return queue[back - 1];
+}
+
+wlerr wlBounds(const wlgraph *g, int start, int end, int *lower, int *upper)
+{
+  const unsigned short *ds, *dt;
+  int i;
+
+  if (start < 0 || start >= g->n || end < 0 || end >= g->n) {
+    return wl_notfound;
+  }
+  if (g->comp != NULL && g->comp[start] != g->comp[end]) {
+    return wl_noladder;
+  }
+  if (g->lfirst != NULL) {
+    if ((*lower = wlLabelDist(g, start, end)) < 0) {
+      return wl_noladder;
+    }
+    *upper = ++*lower;
+    return wl_ok;
+  }
+  *upper = g->n;
+  if (g->nlm > 0) {
+    ds = g->lmdist + (size_t)start * g->nlm;
+    dt = g->lmdist + (size_t)end * g->nlm;
+    for (i = 0; i < g->nlm; i++) {
+      if (ds[i] < CAPPED && dt[i] < CAPPED && ds[i] + dt[i] + 1 < *upper) {
+        *upper = ds[i] + dt[i] + 1;
+      }
+    }
+    *lower = wlLowerBound(g, start, end, dt) + 1;
+  }
+  else {
+    *lower = g->kern->hamming(WORD(g, start), WORD(g, end), g->wlen) + 1;
+  }
+  return wl_ok;
+}
+
+int wlLowerBound(const wlgraph *g, int v, int end, const unsigned short *dt)
+/* The fewest steps from v to end: at least the letters they differ in, and
+ * at least the difference in their distances from any landmark.  dt is
+ * end's row of landmark distances, which the caller looks up once. */
+{
+  const unsigned short *dv = g->lmdist + (size_t)v * g->nlm;
+  int i, d, best = g->kern->hamming(WORD(g, v), WORD(g, end), g->wlen);
+
+  for (i = 0; i < g->nlm; i++) {
+    if (dv[i] < CAPPED && dt[i] < CAPPED) {
+      d = dv[i] > dt[i] ? dv[i] - dt[i] : dt[i] - dv[i];
+      if (d > best) {
+        best = d;
+      }
+    }
+  }
+  return best;
+}
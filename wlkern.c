@@ -0,0 +1,169 @@
+/* Kernels - the loops over a word's letters, one set per word length.
+ * Every graph holds words of one length, known when it is loaded, so each
+ * is given a set of kernels with that length built in: the compiler can
+ * then unroll their loops completely and compare whole words in a few
+ * wide loads, where the generic versions go a letter at a time to a length
+ * known only at run time.  The sets for lengths 2 to MAXKERNEL are made by
+ * one macro; any other length gets the generic set.  Build with
+ * -DWL_GENERIC to give every length the generic set, for comparison.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "wlprivate.h"
+
+#define MAXKERNEL 16
+#define ONES (~(uint64_t)0 / 0xff) /* a 1 in every byte */
+
+static int genericHamming(const char *w1, const char *w2, int wlen)
+{
+  int i, d = 0;
+
+  for (i = 0; i < wlen; i++) {
+    d += w1[i] != w2[i];
+  }
+  return d;
+}
+
+static unsigned long genericHash(const char *s, int wlen)
+/* FNV-1a - saved tables depend on it, so every set must agree */
+{
+  unsigned long h = 2166136261UL;
+  int i;
+
+  for (i = 0; i < wlen; i++) {
+    h = ((h ^ (unsigned char)s[i]) * 16777619UL) & 0xffffffffUL;
+  }
+  return h;
+}
+
+static int genericSame(const char *w1, const char *w2, int wlen)
+{
+  return memcmp(w1, w2, wlen) == 0;
+}
+
+static uint64_t xor8(const char *w1, const char *w2)
+{
+  uint64_t a, b;
+
+  memcpy(&a, w1, 8);
+  memcpy(&b, w2, 8);
+  return a ^ b;
+}
+
+static uint64_t xor4(const char *w1, const char *w2)
+{
+  uint32_t a, b;
+
+  memcpy(&a, w1, 4);
+  memcpy(&b, w2, 4);
+  return a ^ b;
+}
+
+static uint64_t xor2(const char *w1, const char *w2)
+{
+  uint16_t a, b;
+
+  memcpy(&a, w1, 2);
+  memcpy(&b, w2, 2);
+  return (uint64_t)(a ^ b);
+}
+
+static int differ(uint64_t x)
+/* the number of non-zero bytes in x */
+{
+  x |= x >> 4;
+  x |= x >> 2;
+  x |= x >> 1;
+  return (int)(((x & ONES) * ONES) >> 56);
+}
+
+/* The same three with wlen fixed at L, which the argument only repeats.
+ * A word is compared with another in pieces of 8, 4, 2 and 1 letters, each
+ * one load and an exclusive or - with L known, the pieces are picked when
+ * compiling and the branches on i vanish. */
+#define KERNELS(L) \
+static int hamming##L(const char *w1, const char *w2, int wlen) \
+{ \
+  int i, d = 0; \
+  (void)wlen; \
+  for (i = 0; i + 8 <= L; i += 8) { \
+    d += differ(xor8(w1 + i, w2 + i)); \
+  } \
+  if (L - i >= 4) { \
+    d += differ(xor4(w1 + i, w2 + i)); \
+    i += 4; \
+  } \
+  if (L - i >= 2) { \
+    d += differ(xor2(w1 + i, w2 + i)); \
+    i += 2; \
+  } \
+  return L - i >= 1 ? d + (w1[i] != w2[i]) : d; \
+} \
+static unsigned long hash##L(const char *s, int wlen) \
+{ \
+  unsigned long h = 2166136261UL; \
+  int i; \
+  (void)wlen; \
+  for (i = 0; i < L; i++) { \
+    h = ((h ^ (unsigned char)s[i]) * 16777619UL) & 0xffffffffUL; \
+  } \
+  return h; \
+} \
+static int same##L(const char *w1, const char *w2, int wlen) \
+{ \
+  uint64_t x = 0; \
+  int i; \
+  (void)wlen; \
+  for (i = 0; i + 8 <= L; i += 8) { \
+    x |= xor8(w1 + i, w2 + i); \
+  } \
+  if (L - i >= 4) { \
+    x |= xor4(w1 + i, w2 + i); \
+    i += 4; \
+  } \
+  if (L - i >= 2) { \
+    x |= xor2(w1 + i, w2 + i); \
+    i += 2; \
+  } \
+  return x == 0 && (L - i < 1 || w1[i] == w2[i]); \
+}
+
+KERNELS(2)
+KERNELS(3)
+KERNELS(4)
+KERNELS(5)
+KERNELS(6)
+KERNELS(7)
+KERNELS(8)
+KERNELS(9)
+KERNELS(10)
+KERNELS(11)
+KERNELS(12)
+KERNELS(13)
+KERNELS(14)
+KERNELS(15)
+KERNELS(16)
+
+#define KERNELSET(L) { hamming##L, hash##L, same##L }
+
+static const wlkernel generic = { genericHamming, genericHash, genericSame };
+
+static const wlkernel fixed[MAXKERNEL + 1] = {
+  { genericHamming, genericHash, genericSame },
+  { genericHamming, genericHash, genericSame },
+  KERNELSET(2), KERNELSET(3), KERNELSET(4), KERNELSET(5), KERNELSET(6),
+  KERNELSET(7), KERNELSET(8), KERNELSET(9), KERNELSET(10), KERNELSET(11),
+  KERNELSET(12), KERNELSET(13), KERNELSET(14), KERNELSET(15), KERNELSET(16)
+};
+
+const wlkernel *wlKernels(int wlen)
+{
+#ifdef WL_GENERIC
+  (void)fixed;
+  (void)wlen;
+  return &generic;
+#else
+  return wlen >= 0 && wlen <= MAXKERNEL ? &fixed[wlen] : &generic;
+#endif
+}
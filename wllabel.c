@@ -0,0 +1,260 @@
+/* Hub labels - exact distances without searching.
+ * Every word is given a label: a list of (hub, distance) pairs, such that
+ * for any two connected words some hub on a shortest ladder between them is
+ * in both their labels.  Their distance is then the least sum of the two
+ * distances over the hubs they share, found by merging the two labels,
+ * which are kept sorted by hub.
+ * The labels are built by pruned landmark labelling: a BFS from each word
+ * in turn, busiest words first, which adds the word as a hub to the labels
+ * of the words it reaches - except that the BFS goes no further from a word
+ * whose distance the labels built so far already give.  The busy words
+ * early on cover most ladders, so the later searches stop almost at once
+ * and labels stay short.
+ * A hub is stored as its place in that order, which with the distance fits
+ * in 32 bits; graphs are labelled at the same time, one per thread.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "wlprivate.h"
+
+#define MAXHUBDIST 0xfe /* 0xff marks "no distance" in labelGraph() */
+
+typedef struct growing {
+  uint32_t *e; /* a label while it is being built */
+  int n;
+  int cap;
+} growing;
+
+static wlerr labelGraph(wlgraph *g, int nthreads, int arg);
+static wlerr prunedSearch(const wlgraph *g, growing *lab, int root, int hub,
+                          unsigned char *rootd, unsigned char *seen,
+                          int *queue, int *buf);
+static int   addHub(growing *lab, int hub, int d);
+static wlerr packLabels(wlgraph *g, growing *lab);
+static int   byDegree(const wlgraph *g, int *order, int *buf);
+
+wlerr wlHubLabels(wldict *dict, int nthreads)
+{
+  wlerr err;
+  STAT(int i);
+
+  if (dict->image != NULL) {
+    return wl_badarg;
+  }
+  err = wlEachGraph(dict, labelGraph, 0, wlThreadCount(nthreads));
+#ifdef WL_STATS
+  for (i = 0; i <= dict->maxlen; i++) {
+    if (dict->graphs[i] != NULL && dict->graphs[i]->lfirst != NULL) {
+      dict->bytes += sizeof(int) * ((long)dict->graphs[i]->n + 1)
+        + sizeof(uint32_t)
+          * (long)dict->graphs[i]->lfirst[dict->graphs[i]->n];
+    }
+  }
+#endif
+  return err;
+}
+
+int wlLabelDist(const wlgraph *g, int u, int v)
+/* the steps from u to v, or -1 if they aren't connected */
+{
+  const uint32_t *a = g->label + g->lfirst[u];
+  const uint32_t *b = g->label + g->lfirst[v];
+  const uint32_t *aend = g->label + g->lfirst[u + 1];
+  const uint32_t *bend = g->label + g->lfirst[v + 1];
+  int d, best = -1;
+
+  while (a < aend && b < bend) {
+    if (HUB(*a) < HUB(*b)) {
+      a++;
+    }
+    else if (HUB(*a) > HUB(*b)) {
+      b++;
+    }
+    else {
+      d = HUBDIST(*a++) + HUBDIST(*b++);
+      if (best == -1 || d < best) {
+        best = d;
+      }
+    }
+  }
+  return best;
+}
+
+static wlerr labelGraph(wlgraph *g, int nthreads, int arg)
+/* The searches have to run one after another, as each is pruned by the
+ * labels of those before, so a graph gets one thread however many are
+ * spare. */
+{
+  growing *lab = (growing *)calloc(g->n, sizeof(growing));
+  int *order = (int *)malloc(sizeof(int) * g->n);
+  int *queue = (int *)malloc(sizeof(int) * g->n);
+  int *buf = (int *)malloc(sizeof(int) * (g->maxdeg + 1));
+  unsigned char *rootd = (unsigned char *)malloc(g->n);
+  unsigned char *seen = (unsigned char *)calloc(g->n, 1);
+  int i;
+  wlerr err = wl_ok;
+
+  (void)nthreads;
+  (void)arg;
+  if (lab == NULL || order == NULL || queue == NULL || buf == NULL
+  ||  rootd == NULL || seen == NULL) {
+    err = wl_nomem;
+  }
+  else if (g->n >= 1 << 24) {
+    err = wl_badarg; /* too many words to fit a hub in 24 bits */
+  }
+  if (err == wl_ok && !byDegree(g, order, buf)) {
+    err = wl_nomem;
+  }
+  if (err == wl_ok) {
+    for (i = 0; i < g->n; i++) {
+      rootd[i] = 0xff;
+    }
+    for (i = 0; i < g->n && err == wl_ok; i++) {
+      err = prunedSearch(g, lab, order[i], i, rootd, seen, queue, buf);
+    }
+  }
+  if (err == wl_ok) {
+    err = packLabels(g, lab);
+  }
+  for (i = 0; lab != NULL && i < g->n; i++) {
+    free(lab[i].e);
+  }
+  free(lab);
+  free(order);
+  free(queue);
+  free(buf);
+  free(rootd);
+  free(seen);
+  return err;
+}
+
+static wlerr prunedSearch(const wlgraph *g, growing *lab, int root, int hub,
+                          unsigned char *rootd, unsigned char *seen,
+                          int *queue, int *buf)
+/* BFS from root, labelling each word it reaches with (hub, distance) unless
+ * the labels so far already give that distance.  rootd holds root's label
+ * spread out by hub, so each check is one pass over the other label. */
+{
+  const uint32_t *e;
+  const int *nbrs;
+  int front, back, d, u, i, k, deg, best;
+  wlerr err = wl_ok;
+
+  for (k = 0; k < lab[root].n; k++) {
+    rootd[HUB(lab[root].e[k])] = (unsigned char)HUBDIST(lab[root].e[k]);
+  }
+  queue[0] = root;
+  seen[root] = 1;
+  d = 0;
+  for (front = 0, back = 1, i = 1; front < back && err == wl_ok; front++) {
+    if (front == i) { /* on to the next level */
+      i = back;
+      if (++d > MAXHUBDIST) {
+        err = wl_badarg;
+        break;
+      }
+    }
+    u = queue[front];
+    best = -1;
+    for (k = 0, e = lab[u].e; k < lab[u].n; k++, e++) {
+      if (rootd[HUB(*e)] != 0xff
+      &&  (best == -1 || rootd[HUB(*e)] + HUBDIST(*e) < best)) {
+        best = rootd[HUB(*e)] + HUBDIST(*e);
+      }
+    }
+    if (best != -1 && best <= d) {
+      continue; /* pruned - a hub before this one covers u */
+    }
+    if (!addHub(&lab[u], hub, d)) {
+      err = wl_nomem;
+      break;
+    }
+    deg = wlAdjacent(g, u, buf, &nbrs);
+    for (k = 0; k < deg; k++) {
+      if (!seen[nbrs[k]]) {
+        seen[nbrs[k]] = 1;
+        queue[back++] = nbrs[k];
+      }
+    }
+  }
+  for (k = 0; k < back; k++) {
+    seen[queue[k]] = 0;
+  }
+  for (k = 0; k < lab[root].n; k++) {
+    rootd[HUB(lab[root].e[k])] = 0xff;
+  }
+  return err;
+}
+
+static int addHub(growing *lab, int hub, int d)
+/* hubs are added in order, so the label stays sorted */
+{
+  uint32_t *tmp;
+
+  if (lab->n == lab->cap) {
+    lab->cap = lab->cap == 0 ? 4 : lab->cap * 2;
+    tmp = (uint32_t *)realloc(lab->e, sizeof(uint32_t) * lab->cap);
+    if (tmp == NULL) {
+      return 0;
+    }
+    lab->e = tmp;
+  }
+  lab->e[lab->n++] = (uint32_t)hub << 8 | (uint32_t)d;
+  return 1;
+}
+
+static wlerr packLabels(wlgraph *g, growing *lab)
+/* copies the labels into one array, indexed like adj */
+{
+  int i;
+
+  g->lfirst = (int *)malloc(sizeof(int) * (g->n + 1));
+  if (g->lfirst == NULL) {
+    return wl_nomem;
+  }
+  g->lfirst[0] = 0;
+  for (i = 0; i < g->n; i++) {
+    g->lfirst[i + 1] = g->lfirst[i] + lab[i].n;
+  }
+  g->label = (uint32_t *)malloc(sizeof(uint32_t) * (g->lfirst[g->n] + 1));
+  if (g->label == NULL) {
+    free(g->lfirst);
+    g->lfirst = NULL;
+    return wl_nomem;
+  }
+  for (i = 0; i < g->n; i++) {
+    memcpy(g->label + g->lfirst[i], lab[i].e, sizeof(uint32_t) * lab[i].n);
+  }
+  return wl_ok;
+}
+
+static int byDegree(const wlgraph *g, int *order, int *buf)
+/* counting sort of the words, most neighbours first and then by number -
+ * returns 0 if out of memory */
+{
+  const int *nbrs;
+  int *cnt = (int *)calloc(g->maxdeg + 2, sizeof(int));
+  int *deg = (int *)malloc(sizeof(int) * g->n);
+  int u;
+
+  if (cnt == NULL || deg == NULL) {
+    free(cnt);
+    free(deg);
+    return 0;
+  }
+  for (u = 0; u < g->n; u++) {
+    deg[u] = wlAdjacent(g, u, buf, &nbrs);
+    cnt[g->maxdeg - deg[u] + 1]++;
+  }
+  for (u = 0; u <= g->maxdeg; u++) {
+    cnt[u + 1] += cnt[u];
+  }
+  for (u = 0; u < g->n; u++) {
+    order[cnt[g->maxdeg - deg[u]]++] = u;
+  }
+  free(cnt);
+  free(deg);
+  return 1;
+}
@@ -0,0 +1,176 @@
+/* Internals shared by the library's source files - front-ends should only
+ * include wordladder.h. */
+#ifndef WLPRIVATE_H
+#define WLPRIVATE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "wordladder.h"
+
+#define ALPHA 26 /* letters in the alphabet, i.e. the radix of a key digit */
+#define MAXTHREADS 64
+#define CBLOCK 32 /* words per block of coded neighbour lists */
+
+#ifdef WL_STATS
+#define STAT(x) x
+#else
+#define STAT(x)
+#endif
+
+#define MAGIC "WLADDER3" /* a saved dictionary, then its format's version */
+#define MAGICLEN 8
+#define UNREACHED 0xffff /* landmark distance to a word it can't reach */
+#define CAPPED (UNREACHED - 1) /* a landmark distance too long to hold */
+
+/* a hub label entry is the hub's place in the labelling order, then the
+ * distance to it in the low 8 bits - see wllabel.c */
+#define HUB(e) ((int)((e) >> 8))
+#define HUBDIST(e) ((int)((e) & 0xff))
+
+/* the word numbered id, which is followed by a NUL */
+#define WORD(g, id) ((g)->words + (size_t)(id) * ((g)->wlen + 1))
+
+/* the loops over a word's letters, for one word length - see wlkern.c */
+typedef struct wlkernel {
+  int (*hamming)(const char *w1, const char *w2, int wlen);
+  unsigned long (*hash)(const char *s, int wlen);
+  int (*same)(const char *w1, const char *w2, int wlen);
+} wlkernel;
+
+struct wlgraph {
+  const wldict *dict;
+  int wlen; /* word length */
+  const wlkernel *kern; /* chosen for wlen when the graph is made */
+  int n; /* number of words */
+  char *words;
+  int m; /* links, counting both ways */
+  int maxdeg; /* most neighbours of any word */
+  /* Either first and adj are set, or - once compacted - the three after */
+  int *first; /* neighbours of word i are adj[first[i]] to adj[first[i+1]-1] */
+  int *adj;
+  unsigned char *code; /* every word's neighbours, coded as in wlcode.c */
+  unsigned int *cblock; /* where the code for each CBLOCK words starts */
+  unsigned short *coff; /* where each word's code starts, from its block's */
+  int *table; /* hash table of word numbers + 1, with 0 for empty slots */
+  int tsize; /* a power of 2 */
+  int *comp; /* component of each word, NULL until wlLandmarks() */
+  int nlm; /* number of landmarks */
+  int *lm; /* landmark word numbers */
+  unsigned short *lmdist; /* n rows of nlm distances from each landmark */
+  int *lfirst; /* hub labels, NULL until wlHubLabels() - word i's label is */
+  uint32_t *label; /* label[lfirst[i]] to label[lfirst[i+1]-1] */
+};
+
+struct wldict {
+  int nwords;
+  int skipped;
+  int maxlen;
+  wlgraph **graphs; /* indexed by length, from 0 to maxlen */
+  void *image; /* a saved dictionary that the graphs' arrays point into */
+  size_t imagesize;
+  int mapped; /* image is the file mapped read-only, not a copy on the heap */
+#ifdef WL_STATS
+  long bytes;
+  double time[wl_nphases];
+#endif
+};
+
+struct wlsearch {
+  const wlgraph *g;
+  unsigned int gen; /* the search's generation - see searchReset() */
+  unsigned int *mark; /* a word is visited if its mark equals gen */
+  int *parent; /* valid for visited words only, -1 at the start */
+  int *queue; /* word numbers, with room for every word */
+  int front;
+  int back;
+  int *path; /* the last ladder found */
+  int *nbuf; /* room for any word's neighbours - see wlAdjacent() */
+  /* for A* only, when the graph has landmarks - see wlLadder() */
+  int *dist; /* valid for visited words, steps from the start */
+  unsigned int *closed; /* a word is expanded if its closed equals gen */
+  int *bucket; /* by estimated ladder length, the top entry of its stack */
+  int nbuckets;
+  int *ent; /* the word in each stack entry */
+  int *below; /* the entry under each one, or -1 */
+#ifdef WL_STATS
+  int *level; /* valid for visited words only, distance from the start */
+  wlstats st;
+#endif
+};
+
+struct wlbatch {
+  const wlgraph *g;
+  int lanes;
+  int nwords; /* 64-bit words per node, for lanes bits */
+  uint64_t *seen; /* by node, the lanes that have reached it */
+  uint64_t *visit; /* by node, the lanes for which it is on the frontier */
+  uint64_t *next; /* by node, the lanes reaching it on the next level */
+  unsigned char *dist; /* by node and lane, valid where seen */
+  int *front; /* the nodes on any lane's frontier */
+  int nfront;
+  int *touched; /* the nodes reached on the next level, then its frontier */
+  int *reached; /* the nodes any lane has reached, to clear for the next */
+  int nreached;
+  int nq;
+  int start[WL_MAXLANES];
+  int end[WL_MAXLANES];
+  wlerr err[WL_MAXLANES];
+  int len[WL_MAXLANES];
+  int off[WL_MAXLANES]; /* where each lane's path starts in paths */
+  int *paths;
+  int pathcap;
+  wlsearch *s; /* for a ladder too long for dist to hold */
+#ifdef WL_STATS
+  wlstats st;
+#endif
+};
+
+typedef struct snapshot {
+  wldict *dict;
+  int refs; /* queries using it, plus one while it is the latest */
+  struct snapshot *next;
+} snapshot;
+
+struct wlwatch {
+  char *path;
+  int wlen;
+  int nthreads;
+  int ms; /* between looks at the file */
+  time_t mtime; /* the file as it was when last loaded */
+  long mnsec;
+  time_t ctime;
+  long cnsec;
+  off_t size;
+  ino_t ino;
+  snapshot *snaps; /* the latest first, then older ones not yet freed */
+  int reloads;
+  int stop;
+  pthread_mutex_t lock; /* for snaps, refs, reloads and stop */
+  pthread_cond_t wake;
+  pthread_t thread;
+};
+
+typedef void *(*wltask)(void *);
+/* work on one graph with nthreads threads, and an argument of its own */
+typedef wlerr (*wlgraphtask)(wlgraph *g, int nthreads, int arg);
+
+int   wlThreadCount(int nthreads);
+wlerr wlEachGraph(wldict *d, wlgraphtask task, int arg, int nthreads);
+wlerr wlLoadImage(FILE *file, wldict **dict);
+void  wlFreeImage(wldict *dict);
+const wlkernel *wlKernels(int wlen);
+int   wlComponents(const wlgraph *g, int *comp, int *queue, int *buf);
+int   wlLowBit(uint64_t x);
+int   wlLowerBound(const wlgraph *g, int v, int end, const unsigned short *dt);
+int   wlLabelDist(const wlgraph *g, int u, int v);
+int   wlAdjacent(const wlgraph *g, int u, int *buf, const int **nbrs);
+int   wlCheckCode(const wlgraph *g, int ncode);
+wlerr wlBuildTable(wlgraph *g);
+void  wlRunThreads(wltask task, void *jobs, size_t jobsize, int njobs);
+double wlTime(void);
+
+#endif
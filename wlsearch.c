@@ -0,0 +1,761 @@
+/* Searching a graph.
+ * A search context holds everything one search needs - the queue, visited
+ * marks and parents, all indexed by word number - and is allocated once so
+ * that later searches make no allocations.  Each thread searching a graph
+ * needs its own context; the graph itself is only ever read.
+ * When the graph has landmarks (wlindex.c) a single search is an A* instead
+ * of a BFS: words are taken in order of the shortest ladder that could run
+ * through them, from the steps taken so far plus the landmarks' lower bound
+ * on the steps still to go, so it heads for the end instead of spreading
+ * out evenly in every direction.  With hub labels (wllabel.c) there is no
+ * search at all: the labels give each word's exact distance to the end, so
+ * the ladder is walked one step at a time.
+ * A batch context runs many searches on one graph as a multi-source BFS:
+ * each node carries a bit per search ("lane") for whether that search has
+ * reached it, and for whether it is on that search's frontier.  One pass over
+ * a frontier node's links then moves every search through it on together,
+ * instead of each search reading the same links again.  The frontier nodes
+ * are also kept in a list, so a level costs only as much as its frontier -
+ * long searches in small components would otherwise pay for the whole graph
+ * on every level.  Each lane's distance to each node it reaches is kept so
+ * its ladder can be traced back after.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "wlprivate.h"
+
+static void searchReset(wlsearch *s);
+static int  isVisited(wlsearch *s, int id);
+static void visit(wlsearch *s, int id, int parent);
+static void findChildren(wlsearch *s, int parent);
+static void enQueue(int id, wlsearch *s);
+static int  deQueue(wlsearch *s);
+static int  queueEmpty(wlsearch *s);
+static int  aStar(wlsearch *s, int start, int end);
+static wlerr labelPath(wlsearch *s, int start, int end, int *len);
+static void push(wlsearch *s, int id, int f, int *nent);
+static int  batchLevel(wlbatch *b, uint64_t *pending, int level);
+static wlerr batchPaths(wlbatch *b);
+static int  pathRoom(wlbatch *b, int need);
+
+wlerr wlSearchNew(const wlgraph *g, wlsearch **s)
+{
+  wlsearch *p = (wlsearch *)calloc(1, sizeof(wlsearch));
+
+  if (p == NULL) {
+    return wl_nomem;
+  }
+  p->g = g;
+  p->gen = 0;
+  p->mark = (unsigned int *)calloc(g->n + 1, sizeof(unsigned int));
+  p->parent = (int *)malloc(sizeof(int) * (g->n + 1));
+  p->queue = (int *)malloc(sizeof(int) * (g->n + 1));
+  p->path = (int *)malloc(sizeof(int) * (g->n + 1));
+  p->nbuf = (int *)malloc(sizeof(int) * (g->maxdeg + 1));
+#ifdef WL_STATS
+  p->level = (int *)malloc(sizeof(int) * (g->n + 1));
+  if (p->level == NULL) {
+    wlSearchFree(p);
+    return wl_nomem;
+  }
+#endif
+  if (p->mark == NULL || p->parent == NULL || p->queue == NULL
+  ||  p->path == NULL || p->nbuf == NULL) {
+    wlSearchFree(p);
+    return wl_nomem;
+  }
+  if (g->nlm > 0) {
+    /* no estimate is more than n - 1 or wlen, so no f is over 2n + wlen */
+    p->nbuckets = 2 * g->n + g->wlen + 1;
+    p->dist = (int *)malloc(sizeof(int) * (g->n + 1));
+    p->closed = (unsigned int *)calloc(g->n + 1, sizeof(unsigned int));
+    p->bucket = (int *)malloc(sizeof(int) * p->nbuckets);
+    p->ent = (int *)malloc(sizeof(int) * (g->m + 1));
+    p->below = (int *)malloc(sizeof(int) * (g->m + 1));
+    if (p->dist == NULL || p->closed == NULL || p->bucket == NULL
+    ||  p->ent == NULL || p->below == NULL) {
+      wlSearchFree(p);
+      return wl_nomem;
+    }
+    memset(p->bucket, -1, sizeof(int) * p->nbuckets);
+  }
+  *s = p;
+  return wl_ok;
+}
+
+void wlSearchFree(wlsearch *s)
+{
+  if (s == NULL) {
+    return;
+  }
+  free(s->mark);
+  free(s->parent);
+  free(s->queue);
+  free(s->path);
+  free(s->nbuf);
+  free(s->dist);
+  free(s->closed);
+  free(s->bucket);
+  free(s->ent);
+  free(s->below);
+#ifdef WL_STATS
+  free(s->level);
+#endif
+  free(s);
+}
+
+wlerr wlLadder(wlsearch *s, int start, int end, const int **path, int *len)
+{
+  int id, n = 0;
+  wlerr err;
+  STAT(double t = wlTime());
+
+  if (start < 0 || start >= s->g->n || end < 0 || end >= s->g->n) {
+    return wl_notfound;
+  }
+  searchReset(s);
+  if (s->g->comp != NULL && s->g->comp[start] != s->g->comp[end]) {
+    STAT(s->st.time[wl_search] = wlTime() - t);
+    return wl_noladder;
+  }
+  if (s->g->lfirst != NULL) {
+    err = labelPath(s, start, end, len);
+    STAT(s->st.time[wl_search] = wlTime() - t);
+    if (err == wl_ok) {
+      *path = s->path;
+    }
+    return err;
+  }
+  if (s->g->nlm > 0) {
+    if (!aStar(s, start, end)) {
+      STAT(s->st.time[wl_search] = wlTime() - t);
+      return wl_noladder;
+    }
+  }
+  else {
+    visit(s, start, -1);
+    enQueue(start, s);
+    while (!isVisited(s, end) && !queueEmpty(s)) {
+      id = deQueue(s);
+      STAT(s->st.dequeued++);
+      findChildren(s, id);
+    }
+  }
+  STAT(s->st.time[wl_search] = wlTime() - t);
+  if (!isVisited(s, end)) {
+    return wl_noladder;
+  }
+
+  /* the parents lead back from the end, so the path is filled in backwards */
+  for (id = end; id != -1; id = s->parent[id]) {
+    n++;
+  }
+  *len = n;
+  for (id = end; id != -1; id = s->parent[id]) {
+    s->path[--n] = id;
+  }
+  *path = s->path;
+  return wl_ok;
+}
+
+wlerr wlLadderLen(wlsearch *s, int start, int end, int *len)
+{
+  const int *path;
+  int d;
+
+  if (s->g->lfirst == NULL) {
+    return wlLadder(s, start, end, &path, len);
+  }
+  if (start < 0 || start >= s->g->n || end < 0 || end >= s->g->n) {
+    return wl_notfound;
+  }
+  if ((d = wlLabelDist(s->g, start, end)) < 0) {
+    return wl_noladder;
+  }
+  *len = d + 1;
+  return wl_ok;
+}
+
+wlerr wlDistances(wlsearch *s, int from, int *dist, int *toward)
+{
+  const wlgraph *g = s->g;
+  const int *nbrs;
+  int u, v, i, deg;
+  STAT(double t = wlTime());
+
+  if (from < 0 || from >= g->n) {
+    return wl_notfound;
+  }
+  searchReset(s);
+  for (v = 0; v < g->n; v++) {
+    dist[v] = -1;
+    if (toward != NULL) {
+      toward[v] = -1;
+    }
+  }
+  dist[from] = 0;
+  enQueue(from, s);
+  while (!queueEmpty(s)) {
+    u = deQueue(s);
+    STAT(s->st.dequeued++);
+    deg = wlAdjacent(g, u, s->nbuf, &nbrs);
+    for (i = 0; i < deg; i++) {
+      STAT(s->st.checked++);
+      v = nbrs[i];
+      if (dist[v] == -1) {
+        dist[v] = dist[u] + 1;
+        if (toward != NULL) {
+          toward[v] = u;
+        }
+        enQueue(v, s);
+      }
+    }
+  }
+  STAT(s->st.time[wl_search] = wlTime() - t);
+  return wl_ok;
+}
+
+void wlStats(const wlsearch *s, wlstats *st)
+{
+  memset(st, 0, sizeof(wlstats));
+#ifdef WL_STATS
+  *st = s->st;
+  st->bytes += s->g->dict->bytes;
+  st->time[wl_load] = s->g->dict->time[wl_load];
+  st->time[wl_build] = s->g->dict->time[wl_build];
+#else
+  (void)s;
+#endif
+}
+
+static void searchReset(wlsearch *s)
+/* Moving on a generation unvisits every word at once.  Only when the counter
+ * wraps round do the marks need clearing, as old ones could then match. */
+{
+  s->gen++;
+  if (s->gen == 0) {
+    memset(s->mark, 0, sizeof(unsigned int) * s->g->n);
+    if (s->closed != NULL) {
+      memset(s->closed, 0, sizeof(unsigned int) * s->g->n);
+    }
+    s->gen = 1;
+  }
+  s->front = s->back = 0;
+#ifdef WL_STATS
+  memset(&s->st, 0, sizeof(wlstats));
+  s->st.bytes = sizeof(wlsearch) + (sizeof(unsigned int) + sizeof(int) * 4)
+    * ((long)s->g->n + 1);
+  if (s->closed != NULL) {
+    s->st.bytes += (sizeof(unsigned int) + sizeof(int)) * ((long)s->g->n + 1)
+      + sizeof(int) * (s->nbuckets + 2 * ((long)s->g->m + 1));
+  }
+#endif
+}
+
+static int isVisited(wlsearch *s, int id)
+{
+  return s->mark[id] == s->gen;
+}
+
+static void visit(wlsearch *s, int id, int parent)
+{
+  s->mark[id] = s->gen;
+  s->parent[id] = parent;
+#ifdef WL_STATS
+  s->level[id] = parent == -1 ? 0 : s->level[parent] + 1;
+  if (s->level[id] < WL_MAXLEVELS) {
+    s->st.frontier[s->level[id]]++;
+    if (s->level[id] >= s->st.levels) {
+      s->st.levels = s->level[id] + 1;
+    }
+  }
+#endif
+}
+
+static void findChildren(wlsearch *s, int parent)
+{
+  const int *nbrs;
+  int i, deg = wlAdjacent(s->g, parent, s->nbuf, &nbrs);
+
+  for (i = 0; i < deg; i++) {
+    STAT(s->st.checked++);
+    if (!isVisited(s, nbrs[i])) {
+      visit(s, nbrs[i], parent);
+      enQueue(nbrs[i], s);
+    }
+  }
+}
+
+static void enQueue(int id, wlsearch *s)
+/* each word is only queued once per search, so the queue can't overflow */
+{
+  s->queue[s->back++] = id;
+}
+
+static int deQueue(wlsearch *s)
+/* callers check queueEmpty() first */
+{
+  return s->queue[s->front++];
+}
+
+static int queueEmpty(wlsearch *s)
+{
+  return s->front == s->back;
+}
+
+static int aStar(wlsearch *s, int start, int end)
+/* The estimate never drops by more than one a step, so a word's dist is
+ * final once it is expanded and the f values expanded never go down.  The
+ * open words are kept in a stack for each f, scanned from lo upwards; the
+ * newest are taken first, as they are the furthest along.  A word whose
+ * dist improves is pushed again and its old entry skipped when it comes up.
+ * Returns 0 if end can't be reached. */
+{
+  const wlgraph *g = s->g;
+  const unsigned short *dt = g->lmdist + (size_t)end * g->nlm;
+  const int *nbrs;
+  int lo, hi, e, u, v, i, f, deg, nent = 0;
+
+  s->mark[start] = s->gen;
+  s->dist[start] = 0;
+  s->parent[start] = -1;
+  lo = hi = wlLowerBound(g, start, end, dt);
+  push(s, start, lo, &nent);
+  while (lo <= hi) {
+    if ((e = s->bucket[lo]) == -1) {
+      lo++;
+      continue;
+    }
+    s->bucket[lo] = s->below[e];
+    u = s->ent[e];
+    if (s->closed[u] == s->gen) {
+      continue;
+    }
+    s->closed[u] = s->gen;
+#ifdef WL_STATS
+    s->st.dequeued++;
+    if (s->dist[u] < WL_MAXLEVELS) {
+      s->st.frontier[s->dist[u]]++;
+      if (s->dist[u] >= s->st.levels) {
+        s->st.levels = s->dist[u] + 1;
+      }
+    }
+#endif
+    if (u == end) {
+      for (; lo <= hi; lo++) {
+        s->bucket[lo] = -1;
+      }
+      return 1;
+    }
+    deg = wlAdjacent(g, u, s->nbuf, &nbrs);
+    for (i = 0; i < deg; i++) {
+      STAT(s->st.checked++);
+      v = nbrs[i];
+      if (s->closed[v] != s->gen
+      &&  (!isVisited(s, v) || s->dist[u] + 1 < s->dist[v])) {
+        s->mark[v] = s->gen;
+        s->dist[v] = s->dist[u] + 1;
+        s->parent[v] = u;
+        f = s->dist[v] + wlLowerBound(g, v, end, dt);
+        push(s, v, f, &nent);
+        if (f > hi) {
+          hi = f;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+static wlerr labelPath(wlsearch *s, int start, int end, int *len)
+/* Each step is to the first neighbour a step nearer the end, so only the
+ * words on the ladder are expanded.  A saved file's labels are only checked
+ * for their shape, so a distance that can't be walked means a damaged
+ * file. */
+{
+  const wlgraph *g = s->g;
+  const int *nbrs;
+  int d = wlLabelDist(g, start, end), k, i, deg, cur = start;
+
+  if (d < 0) {
+    return wl_noladder;
+  }
+  if (d >= g->n) {
+    return wl_badfile;
+  }
+  s->path[0] = start;
+  for (k = 1; k <= d; k++) {
+    STAT(s->st.dequeued++);
+    deg = wlAdjacent(g, cur, s->nbuf, &nbrs);
+    for (i = 0; i < deg; i++) {
+      STAT(s->st.checked++);
+      if (wlLabelDist(g, nbrs[i], end) == d - k) {
+        break;
+      }
+    }
+    if (i == deg) {
+      return wl_badfile;
+    }
+    cur = s->path[k] = nbrs[i];
+  }
+  STAT(s->st.levels = d + 1 < WL_MAXLEVELS ? d + 1 : WL_MAXLEVELS);
+  *len = d + 1;
+  return wl_ok;
+}
+
+static void push(wlsearch *s, int id, int f, int *nent)
+/* a word is only pushed when its dist improves, which happens at most once
+ * per link, so there are never more entries than links */
+{
+  s->ent[*nent] = id;
+  s->below[*nent] = s->bucket[f];
+  s->bucket[f] = (*nent)++;
+}
+
+wlerr wlBatchNew(const wlgraph *g, int lanes, wlbatch **b)
+{
+  wlbatch *p;
+  size_t n = (size_t)g->n + 1;
+  wlerr err;
+
+  if (lanes != 64 && lanes != 128 && lanes != 256) {
+    return wl_badarg;
+  }
+  if ((p = (wlbatch *)calloc(1, sizeof(wlbatch))) == NULL) {
+    return wl_nomem;
+  }
+  p->g = g;
+  p->lanes = lanes;
+  p->nwords = lanes / 64;
+  p->seen = (uint64_t *)calloc(p->nwords * n, sizeof(uint64_t));
+  p->visit = (uint64_t *)calloc(p->nwords * n, sizeof(uint64_t));
+  p->next = (uint64_t *)calloc(p->nwords * n, sizeof(uint64_t));
+  p->dist = (unsigned char *)malloc(lanes * n);
+  p->front = (int *)malloc(sizeof(int) * n);
+  p->touched = (int *)malloc(sizeof(int) * n);
+  p->reached = (int *)malloc(sizeof(int) * n);
+  p->pathcap = lanes * 16;
+  p->paths = (int *)malloc(sizeof(int) * p->pathcap);
+  if (p->seen == NULL || p->visit == NULL || p->next == NULL
+  ||  p->dist == NULL || p->front == NULL || p->touched == NULL
+  ||  p->reached == NULL || p->paths == NULL) {
+    wlBatchFree(p);
+    return wl_nomem;
+  }
+  if ((err = wlSearchNew(g, &p->s)) != wl_ok) {
+    wlBatchFree(p);
+    return err;
+  }
+  *b = p;
+  return wl_ok;
+}
+
+int wlBatchLanes(const wlgraph *g)
+/* In a sparse graph the searches seldom share frontier nodes, so moving
+ * them on together saves little and the wider rows cost more.  On
+ * dictwords.txt batches win up to 6 letters, where words average 3 or more
+ * neighbours, and lose from 7 letters, where they average nearer 2.  A
+ * graph with hub labels is never searched at all. */
+{
+  if (g->lfirst != NULL || g->m < 3 * g->n) {
+    return 1;
+  }
+  return WL_MAXLANES;
+}
+
+void wlBatchFree(wlbatch *b)
+{
+  if (b == NULL) {
+    return;
+  }
+  free(b->seen);
+  free(b->visit);
+  free(b->next);
+  free(b->dist);
+  free(b->front);
+  free(b->touched);
+  free(b->reached);
+  free(b->paths);
+  wlSearchFree(b->s);
+  free(b);
+}
+
+wlerr wlBatchLadders(wlbatch *b, const int *starts, const int *ends, int nq)
+/* A lane is pending until it reaches its end, and only pending lanes are
+ * moved on, so finished searches cost nothing.  Distances are kept in a
+ * byte, so the few searches still going after 255 levels are finished off
+ * one at a time - as is every search if the graph has hub labels, since
+ * reading a ladder off them beats any search. */
+{
+  const wlgraph *g = b->g;
+  uint64_t pending[WL_MAXLANES / 64], *seen;
+  int q, w, v, level = 0;
+  STAT(double t = wlTime());
+
+  if (nq < 0 || nq > b->lanes) {
+    return wl_badarg;
+  }
+  b->nq = nq;
+  for (q = 0; q < b->nreached; q++) { /* only these were set last time */
+    v = b->reached[q];
+    memset(b->seen + v * b->nwords, 0, sizeof(uint64_t) * b->nwords);
+    memset(b->visit + v * b->nwords, 0, sizeof(uint64_t) * b->nwords);
+  }
+  b->nreached = 0;
+  b->nfront = 0;
+  memset(pending, 0, sizeof(pending));
+#ifdef WL_STATS
+  memset(&b->st, 0, sizeof(wlstats));
+  b->st.bytes = sizeof(wlbatch) + sizeof(int) * b->pathcap
+    + (sizeof(uint64_t) * 3 * b->nwords + b->lanes + sizeof(int) * 3)
+      * ((long)g->n + 1);
+#endif
+  for (q = 0; q < nq; q++) {
+    b->start[q] = starts[q];
+    b->end[q] = ends[q];
+    b->err[q] = wl_ok;
+    if (starts[q] < 0 || starts[q] >= g->n
+    ||  ends[q] < 0 || ends[q] >= g->n) {
+      b->err[q] = wl_notfound;
+      continue;
+    }
+    if (g->comp != NULL && g->comp[starts[q]] != g->comp[ends[q]]) {
+      b->err[q] = wl_noladder;
+      continue;
+    }
+    if (g->lfirst != NULL) {
+      b->err[q] = wl_badarg; /* see batchPaths() */
+      continue;
+    }
+    seen = b->seen + starts[q] * b->nwords;
+    for (w = 0; w < b->nwords && seen[w] == 0; w++)
+      ;
+    if (w == b->nwords) { /* no lane starts here yet */
+      b->reached[b->nreached++] = starts[q];
+      b->front[b->nfront++] = starts[q];
+    }
+    seen[q / 64] |= (uint64_t)1 << (q % 64);
+    b->visit[starts[q] * b->nwords + q / 64] |= (uint64_t)1 << (q % 64);
+    b->dist[(size_t)starts[q] * b->lanes + q] = 0;
+    if (starts[q] != ends[q]) {
+      pending[q / 64] |= (uint64_t)1 << (q % 64);
+    }
+  }
+  STAT(b->st.frontier[0] = nq);
+  STAT(b->st.levels = 1);
+
+  while (g->lfirst == NULL && level < 255 && batchLevel(b, pending, level)) {
+    level++;
+  }
+  for (w = 0; w < b->nwords; w++) {
+    while (pending[w] != 0) {
+      q = w * 64 + wlLowBit(pending[w]);
+      pending[w] &= pending[w] - 1;
+      if (level < 255) {
+        b->err[q] = wl_noladder; /* the frontier ran out */
+      }
+      else {
+        b->err[q] = wl_badarg; /* too long for dist - see batchPaths() */
+      }
+    }
+  }
+  STAT(b->st.time[wl_search] = wlTime() - t);
+  return batchPaths(b);
+}
+
+static int batchLevel(wlbatch *b, uint64_t *pending, int level)
+/* Moves every pending lane on one level, and returns 0 once none of them
+ * has anywhere left to go.  A node goes on the touched list the first time
+ * a link reaches it this level, while its next row is still all zeros. */
+{
+  const wlgraph *g = b->g;
+  uint64_t *visit, *next, *seen, x, was, fresh;
+  const int *nbrs;
+  int *tmp;
+  int k, v, i, w, q, deg, reached, ntouched = 0, moved = 0;
+
+  for (k = 0; k < b->nfront; k++) {
+    visit = b->visit + b->front[k] * b->nwords;
+    for (w = 0; w < b->nwords && (visit[w] & pending[w]) == 0; w++)
+      ;
+    if (w == b->nwords) {
+      continue;
+    }
+    STAT(b->st.dequeued++);
+    deg = wlAdjacent(g, b->front[k], b->s->nbuf, &nbrs);
+    for (i = 0; i < deg; i++) {
+      STAT(b->st.checked++);
+      next = b->next + nbrs[i] * b->nwords;
+      for (w = 0, was = 0; w < b->nwords; w++) {
+        was |= next[w];
+        next[w] |= visit[w] & pending[w];
+      }
+      if (was == 0) {
+        b->touched[ntouched++] = nbrs[i];
+      }
+    }
+  }
+  for (k = 0; k < b->nfront; k++) {
+    memset(b->visit + b->front[k] * b->nwords, 0,
+           sizeof(uint64_t) * b->nwords);
+  }
+  b->nfront = 0;
+  for (k = 0; k < ntouched; k++) {
+    v = b->touched[k];
+    next = b->next + v * b->nwords;
+    seen = b->seen + v * b->nwords;
+    visit = b->visit + v * b->nwords;
+    for (w = reached = 0, fresh = 0; w < b->nwords; w++) {
+      x = next[w] & ~seen[w];
+      next[w] = 0;
+      visit[w] = x;
+      fresh |= seen[w];
+      if (x == 0) {
+        continue;
+      }
+      seen[w] |= x;
+      STAT(if (!reached && level + 1 < WL_MAXLEVELS)
+             b->st.frontier[level + 1]++);
+      reached = 1;
+      while (x != 0) {
+        b->dist[(size_t)v * b->lanes + w * 64 + wlLowBit(x)]
+          = (unsigned char)(level + 1);
+        x &= x - 1;
+      }
+    }
+    if (reached) {
+      moved = 1;
+      b->touched[b->nfront++] = v; /* the frontier is built in place */
+      if (fresh == 0) {
+        b->reached[b->nreached++] = v;
+      }
+    }
+  }
+  tmp = b->front;
+  b->front = b->touched;
+  b->touched = tmp;
+#ifdef WL_STATS
+  if (moved && level + 2 > b->st.levels && level + 2 <= WL_MAXLEVELS) {
+    b->st.levels = level + 2;
+  }
+#endif
+
+  for (w = 0; w < b->nwords; w++) {
+    x = pending[w];
+    while (x != 0) {
+      q = w * 64 + wlLowBit(x);
+      x &= x - 1;
+      if (b->seen[b->end[q] * b->nwords + w] & ((uint64_t)1 << (q % 64))) {
+        pending[w] &= ~((uint64_t)1 << (q % 64));
+      }
+    }
+  }
+  for (w = 0; w < b->nwords && pending[w] == 0; w++)
+    ;
+  return moved && w < b->nwords;
+}
+
+static wlerr batchPaths(wlbatch *b)
+/* Each lane's ladder is traced back from its end, through any neighbour
+ * that lane reached one level sooner. */
+{
+  const wlgraph *g = b->g;
+  const int *path, *nbrs;
+  int q, d, i, deg, cur, total = 0;
+
+  for (q = 0; q < b->nq; q++) {
+    b->off[q] = total;
+    b->len[q] = 0;
+    if (b->err[q] == wl_badarg) { /* too long, or answered by the labels */
+      b->err[q] = wlLadder(b->s, b->start[q], b->end[q], &path, &b->len[q]);
+      if (b->err[q] == wl_ok) {
+        if (!pathRoom(b, total + b->len[q])) {
+          return wl_nomem;
+        }
+        memcpy(b->paths + total, path, sizeof(int) * b->len[q]);
+        total += b->len[q];
+      }
+      continue;
+    }
+    if (b->err[q] != wl_ok) {
+      continue;
+    }
+    b->len[q] = b->dist[(size_t)b->end[q] * b->lanes + q] + 1;
+    if (!pathRoom(b, total + b->len[q])) {
+      return wl_nomem;
+    }
+    cur = b->end[q];
+    b->paths[total + b->len[q] - 1] = cur;
+    for (d = b->len[q] - 2; d >= 0; d--) {
+      deg = wlAdjacent(g, cur, b->s->nbuf, &nbrs);
+      for (i = 0; i < deg; i++) {
+        if ((b->seen[nbrs[i] * b->nwords + q / 64]
+             & ((uint64_t)1 << (q % 64)))
+        &&  b->dist[(size_t)nbrs[i] * b->lanes + q] == d) {
+          break;
+        }
+      }
+      cur = nbrs[i];
+      b->paths[total + d] = cur;
+    }
+    total += b->len[q];
+  }
+  return wl_ok;
+}
+
+static int pathRoom(wlbatch *b, int need)
+/* grows paths to hold need word numbers, returning 0 if it can't */
+{
+  int *tmp;
+
+  if (need > b->pathcap) {
+    if ((tmp = (int *)realloc(b->paths, sizeof(int) * need * 2)) == NULL) {
+      return 0;
+    }
+    b->paths = tmp;
+    b->pathcap = need * 2;
+  }
+  return 1;
+}
+
+wlerr wlBatchPath(const wlbatch *b, int q, const int **path, int *len)
+{
+  if (q < 0 || q >= b->nq) {
+    return wl_badarg;
+  }
+  if (b->err[q] == wl_ok) {
+    *path = b->paths + b->off[q];
+    *len = b->len[q];
+  }
+  return b->err[q];
+}
+
+void wlBatchStats(const wlbatch *b, wlstats *st)
+{
+  memset(st, 0, sizeof(wlstats));
+#ifdef WL_STATS
+  *st = b->st;
+  st->bytes += b->g->dict->bytes;
+  st->time[wl_load] = b->g->dict->time[wl_load];
+  st->time[wl_build] = b->g->dict->time[wl_build];
+#else
+  (void)b;
+#endif
+}
+
+int wlLowBit(uint64_t x)
+/* the number of the lowest set bit in x, which mustn't be 0 */
+{
+#ifdef __GNUC__
+  return __builtin_ctzll(x);
+#else
+  int i = 0;
+
+  while ((x & 1) == 0) {
+    x >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
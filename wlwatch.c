@@ -0,0 +1,224 @@
+/* Reloading a dictionary while it is in use.
+ * A watcher owns a list of snapshots of the dictionary, the latest first.
+ * Queries take the latest with wlAcquire() and hand it back with
+ * wlRelease(); neither does more than count references under a mutex, so
+ * they never wait for a load.  A background thread looks at the file every
+ * so often, and when its times, size or inode have changed loads it afresh,
+ * with no lock held, then puts the new snapshot at the head of the list.
+ * Queries already running carry on with the snapshot they took, and an old
+ * snapshot is freed - by the same thread, on a later look - once nothing is
+ * using it.  The read-copy-update pattern, with reference counts in place
+ * of grace periods.
+ */
+#define _POSIX_C_SOURCE 200809L /* for stat()'s nanoseconds */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "wlprivate.h"
+
+static void     *watchFile(void *arg);
+static int       fileChanged(wlwatch *w);
+static snapshot *unusedSnapshots(wlwatch *w);
+static void      freeSnapshots(snapshot *s);
+
+wlerr wlWatchNew(const char *path, int wlen, int nthreads, int ms,
+                 wlwatch **w)
+{
+  wlwatch *nw;
+  wlerr err;
+
+  if (ms < 1) {
+    return wl_badarg;
+  }
+  if ((nw = (wlwatch *)calloc(1, sizeof(wlwatch))) == NULL
+  ||  (nw->path = (char *)malloc(strlen(path) + 1)) == NULL
+  ||  (nw->snaps = (snapshot *)calloc(1, sizeof(snapshot))) == NULL) {
+    if (nw != NULL) {
+      free(nw->path);
+    }
+    free(nw);
+    return wl_nomem;
+  }
+  strcpy(nw->path, path);
+  nw->wlen = wlen;
+  nw->nthreads = nthreads;
+  nw->ms = ms;
+  fileChanged(nw); /* before loading, so no change can slip by */
+  if ((err = wlLoad(path, wlen, nthreads, &nw->snaps->dict)) != wl_ok) {
+    free(nw->snaps);
+    free(nw->path);
+    free(nw);
+    return err;
+  }
+  nw->snaps->refs = 1;
+  pthread_mutex_init(&nw->lock, NULL);
+  pthread_cond_init(&nw->wake, NULL);
+  if (pthread_create(&nw->thread, NULL, watchFile, nw) != 0) {
+    pthread_mutex_destroy(&nw->lock);
+    pthread_cond_destroy(&nw->wake);
+    freeSnapshots(nw->snaps);
+    free(nw->path);
+    free(nw);
+    return wl_nomem;
+  }
+  *w = nw;
+  return wl_ok;
+}
+
+void wlWatchFree(wlwatch *w)
+{
+  if (w == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&w->lock);
+  w->stop = 1;
+  pthread_cond_signal(&w->wake);
+  pthread_mutex_unlock(&w->lock);
+  pthread_join(w->thread, NULL);
+  pthread_mutex_destroy(&w->lock);
+  pthread_cond_destroy(&w->wake);
+  freeSnapshots(w->snaps);
+  free(w->path);
+  free(w);
+}
+
+const wldict *wlAcquire(wlwatch *w)
+{
+  const wldict *d;
+
+  pthread_mutex_lock(&w->lock);
+  w->snaps->refs++;
+  d = w->snaps->dict;
+  pthread_mutex_unlock(&w->lock);
+  return d;
+}
+
+void wlRelease(wlwatch *w, const wldict *dict)
+{
+  snapshot *s;
+
+  pthread_mutex_lock(&w->lock);
+  for (s = w->snaps; s != NULL && s->dict != dict; s = s->next)
+    ;
+  if (s != NULL) {
+    s->refs--;
+  }
+  pthread_mutex_unlock(&w->lock);
+}
+
+int wlReloads(wlwatch *w)
+{
+  int n;
+
+  pthread_mutex_lock(&w->lock);
+  n = w->reloads;
+  pthread_mutex_unlock(&w->lock);
+  return n;
+}
+
+static void *watchFile(void *arg)
+/* A load that fails - the file half written, say - leaves the latest
+ * snapshot as it is; the file will have changed again by the time it is
+ * whole, and is tried again then. */
+{
+  wlwatch *w = (wlwatch *)arg;
+  snapshot *s, *unused;
+  struct timeval now;
+  struct timespec until;
+  wldict *d;
+
+  pthread_mutex_lock(&w->lock);
+  while (!w->stop) {
+    gettimeofday(&now, NULL);
+    until.tv_sec = now.tv_sec + w->ms / 1000;
+    until.tv_nsec = now.tv_usec * 1000L + w->ms % 1000 * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+      until.tv_sec++;
+      until.tv_nsec -= 1000000000L;
+    }
+    while (!w->stop
+    &&     pthread_cond_timedwait(&w->wake, &w->lock, &until) != ETIMEDOUT)
+      ;
+    if (w->stop) {
+      break;
+    }
+    unused = unusedSnapshots(w);
+    pthread_mutex_unlock(&w->lock);
+    freeSnapshots(unused);
+    d = NULL;
+    s = NULL;
+    if (fileChanged(w)
+    &&  wlLoad(w->path, w->wlen, w->nthreads, &d) == wl_ok
+    &&  (s = (snapshot *)malloc(sizeof(snapshot))) == NULL) {
+      wlFree(d);
+    }
+    pthread_mutex_lock(&w->lock);
+    if (s != NULL) {
+      s->dict = d;
+      s->refs = 1;
+      s->next = w->snaps;
+      w->snaps->refs--; /* no longer the latest */
+      w->snaps = s;
+      w->reloads++;
+    }
+  }
+  pthread_mutex_unlock(&w->lock);
+  return NULL;
+}
+
+static int fileChanged(wlwatch *w)
+/* Only the watcher's own thread reads or writes the file's details, after
+ * wlWatchNew().  A file that can't be looked at is taken to be unchanged.
+ * The times go to the nanosecond, and the change time is checked as well,
+ * so a rewrite in place that keeps the size is seen even within the second
+ * of the last load - unless the filesystem's clock hasn't ticked since. */
+{
+  struct stat st;
+
+  if (stat(w->path, &st) != 0
+  ||  (st.st_mtime == w->mtime && st.st_mtim.tv_nsec == w->mnsec
+       && st.st_ctime == w->ctime && st.st_ctim.tv_nsec == w->cnsec
+       && st.st_size == w->size && st.st_ino == w->ino)) {
+    return 0;
+  }
+  w->mtime = st.st_mtime;
+  w->mnsec = st.st_mtim.tv_nsec;
+  w->ctime = st.st_ctime;
+  w->cnsec = st.st_ctim.tv_nsec;
+  w->size = st.st_size;
+  w->ino = st.st_ino;
+  return 1;
+}
+
+static snapshot *unusedSnapshots(wlwatch *w)
+/* unlinks the snapshots no longer in use and returns them as a list - the
+ * latest is always in use, by the watcher itself */
+{
+  snapshot **p = &w->snaps->next, *s, *unused = NULL;
+
+  while ((s = *p) != NULL) {
+    if (s->refs == 0) {
+      *p = s->next;
+      s->next = unused;
+      unused = s;
+    }
+    else {
+      p = &s->next;
+    }
+  }
+  return unused;
+}
+
+static void freeSnapshots(snapshot *s)
+{
+  snapshot *next;
+
+  for (; s != NULL; s = next) {
+    next = s->next;
+    wlFree(s->dict);
+    free(s);
+  }
+}
@@ -1,102 +1,170 @@
 /* Word ladder generator!
  * given 2 word inputs of the same length, attempts to build a ladder between
  * them by changing one letter at a time.
- * Builds a linked list of correct-length words from the dictionary file in
- * argv[1], which is then overlaid with a linked list queue implementation
- * which uses the same nodes.
- * This enables a breadth-first search to find the shortest path by placing
- * each child node in the queue.
+ * The dictionary file in argv[1] is loaded by libwordladder (wordladder.h),
+ * which numbers the words of each length and works out which are one letter
+ * apart.  A breadth-first search of those links then finds the shortest
+ * path.  This file is just the front-end.
+ * With "-b" after the dictionary, it runs in batch mode instead: each line
+ * of stdin holds a source and target word, and each line of stdout the
+ * ladder between them.  Queries are grouped by word length and searched
+ * up to 256 at a time, by a multi-source search that moves them all on
+ * together - except for lengths whose words have too few neighbours for
+ * that to pay, which are searched for one ladder at a time.  WL_LANES (1,
+ * 64, 128 or 256) picks the same for every length instead.  With WL_RELOAD
+ * set to a number of milliseconds, the dictionary file is looked at that
+ * often and reloaded in the background when it changes, and each block of
+ * queries is answered from the latest version.
+ * With "-s file" after the dictionary, it picks WL_LANDMARKS (default 16)
+ * landmarks for each word length, labels every word with its hubs, and
+ * saves the dictionary, graphs, landmarks and labels to file.  Given the
+ * saved file in place of the dictionary, it starts without building
+ * anything, and reads each ladder straight off the hub labels.  With
+ * WL_COMPACT=1 the graphs are compacted first, which makes the file
+ * smaller but any search that isn't read off the labels slower.
+ * With "-a file" after the dictionary, it writes an analysis of each word
+ * length to file instead: the sizes of its components, its diameter, the
+ * spread of eccentricities, every hardest ladder (between two words as far
+ * apart as any two words of that length), and each word's eccentricity.
+ * The number of threads used to load the dictionary defaults to the number
+ * of cores and can be set with WL_THREADS.
+ * Compiling with -DWL_STATS adds counters to the search and prints a record
+ * of what each query cost; without it the counters are compiled out.
  */
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include "wordladder.h"
 #define PRINTWIDTH 5 /*words per line when printing ladders */
+#define HISTBINS 32 /* power-of-2 bins in the stats histogram */
+#define BATCHLINES 4096 /* queries read in before any are answered */
+#define LANDMARKS 16 /* per word length, when saving a dictionary */
 
-typedef enum mark {unvisited, visited} mark;
-typedef enum warnings { warn_off, warn_on } warnings;
-
-typedef struct node {
-  char *word;
-  mark visited;
-  struct node *parent;
-  struct node *qnext; /*used for the queue */
-  struct node *next; /*used for the linked list */
-} node;
-
-typedef struct list {
-  node *head;
-  node *tail;
-  int wlen; /*word length */
-} list;
-
-typedef struct queue {
-  node *front;
-  node *back;
-} queue;
-
-typedef struct ladder {
-  node *start;
-  node *end;
-} ladder;
+#ifdef WL_STATS
+#define STAT(x) x
+#else
+#define STAT(x)
+#endif
 
 typedef struct buffer {
   char *str;
   short size; /* max buffer size, must include EOS */
 } buffer;
 
-buffer createBuffer(char **argv);
+typedef struct query {
+  char *sourceword;
+  char *targetword;
+  char *answer; /* the line to print */
+} query;
+
+#ifdef WL_STATS
+typedef struct summary {
+  long queries;
+  long hist[HISTBINS]; /* queries by nodes dequeued, in powers of 2 */
+} summary;
+
+summary sum;
+#endif
+
+buffer createBuffer(wldict *dict);
 void checkArgs(int argc, char **argv);
-void getFileInfo(char **argv, buffer *b);
-void checkFile(FILE *file);
+void checkErr(wlerr err);
 char *getInput(char *msg, buffer *b);
 void checkInput(char *sourceword, char *targetword);
-void createListfromFile(list *wlist, char **argv, buffer *b);
 void lowerCase(char *s);
-int  checkWord(char *s, warnings w);
 
 char *createString(int wlen, char *s);
-node *createNode(char *s);
-node *findNode(list wlist, char *s);
-void findChildren(list wlist, node *parent, queue *q);
-int  findEd(node* n1, node* n2);
-void printLadder(node *end);
-void printResults(ladder wladder);
-void freeList(list wlist);
-
-void queueInit(queue *q);
-void enQueue(node *n, queue *q);
-node *deQueue(queue *q);
-int  queueEmpty(queue *q);
+int  findNode(const wlgraph *g, char *s);
+void printLadder(const wlgraph *g, const int *path, int len);
+void printResults(const wlgraph *g, const int *path, int len);
+
+void runBatch(const wldict *dict, wlwatch *w);
+void saveDict(wldict *dict, char *path);
+void analyseDict(const wldict *dict, char *path);
+void analyseLength(const wlgraph *g, FILE *out);
+void printHardest(const wlgraph *g, const int *ecc, int diam, FILE *out);
+int  getLanes(void);
+int  getLandmarks(void);
+int  getCompact(void);
+int  getReload(void);
+int  readQueries(query *qs, int max);
+void answerQueries(const wldict *dict, query *qs, int nq, int lanes);
+void answerLength(const wlgraph *g, query *qs, int *which, int n, int lanes);
+char *checkQuery(const wlgraph *g, query *q);
+char *formatLadder(const wlgraph *g, const int *path, int len);
+char *formatError(char *msg, char *word);
+
+#ifdef WL_STATS
+void statsRecord(char *sourceword, char *targetword, wlstats *st, int len);
+void statsSummary(void);
+#endif
 
 int main(int argc, char **argv)
 {
-  list wlist = { NULL, NULL, 0 };  
-  ladder wladder = { NULL, NULL };
-  queue q;
+  wldict *dict;
+  const wlgraph *g;
+  wlsearch *s;
+  const int *path = NULL;
   char *sourceword, *targetword;
   buffer b;
-  
+  int len = 0;
+  wlwatch *w;
+  wlerr err;
+  STAT(wlstats st);
+
   checkArgs(argc,argv);
-  b = createBuffer(argv);
-  getFileInfo(argv, &b);
+  if (argc == 3 && getReload() > 0) {
+    /* one thread to reload with, leaving the rest to the queries */
+    checkErr(wlWatchNew(argv[1], 0, 1, getReload(), &w));
+    runBatch(NULL, w);
+    STAT(statsSummary());
+    wlWatchFree(w);
+    return 0;
+  }
+  checkErr(wlLoad(argv[1], 0, 0, &dict));
+  if (wlSkipped(dict) > 0) {
+    fprintf(stderr,"WARNING: %d words were read from ", wlSkipped(dict));
+    fprintf(stderr,"dictionary but discarded.\n");
+  }
+  if (argc == 4) {
+    if (strcmp(argv[2],"-s") == 0) {
+      saveDict(dict, argv[3]);
+    }
+    else {
+      analyseDict(dict, argv[3]);
+    }
+    wlFree(dict);
+    return 0;
+  }
+  if (argc == 3) {
+    runBatch(dict, NULL);
+    STAT(statsSummary());
+    wlFree(dict);
+    return 0;
+  }
+  printf("%d words read\n",wlWordCount(dict));
+  b = createBuffer(dict);
   sourceword = getInput("Source word : ",&b);
   targetword = getInput("Target word : ",&b);
   checkInput(sourceword,targetword);
-  wlist.wlen = strlen(sourceword);
-  
-  createListfromFile(&wlist, argv, &b);
-  wladder.start = findNode(wlist,sourceword); 
-  wladder.end = findNode(wlist,targetword);
-  queueInit(&q);
-  enQueue(wladder.start, &q);
-  
-  while (wladder.end->parent == NULL && !queueEmpty(&q) ) {
-    findChildren(wlist,deQueue(&q), &q);
-  }
-  printResults(wladder);
-
-  freeList(wlist);
+  if ((g = wlGraph(dict, strlen(sourceword))) == NULL) {
+    checkErr(wl_badlen);
+  }
+
+  checkErr(wlSearchNew(g, &s));
+  err = wlLadder(s, findNode(g,sourceword), findNode(g,targetword),
+                 &path, &len);
+  if (err != wl_noladder) {
+    checkErr(err);
+  }
+  printResults(g, path, err == wl_ok ? len : 0);
+  STAT(wlStats(s, &st));
+  STAT(statsRecord(sourceword, targetword, &st, err == wl_ok ? len : 0));
+  STAT(statsSummary());
+
+  wlSearchFree(s);
+  wlFree(dict);
   free(b.str);
   free(sourceword);
   free(targetword);
@@ -105,7 +173,7 @@ int main(int argc, char **argv)
 
 char *getInput(char *msg, buffer *b)
 {
-/* uses strcspn from string.h to check the num of chars before a \n, 
+/* uses strcspn from string.h to check the num of chars before a \n,
  * and also to remove the \n. */
   printf(msg);
   if (fgets(b->str,b->size + 1,stdin) != NULL) {
@@ -126,11 +194,24 @@ char *getInput(char *msg, buffer *b)
 
 void checkArgs(int argc, char **argv)
 {
-  if ( (argc != 2) || (argv[1] == NULL) )  {
+  if ( (argc < 2 || argc > 4) || (argv[1] == NULL)
+  ||   (argc == 3 && strcmp(argv[2],"-b") != 0)
+  ||   (argc == 4 && strcmp(argv[2],"-s") != 0
+        && strcmp(argv[2],"-a") != 0) )  {
     fprintf(stderr,"ERROR: Incorrect usage:\n");
-    fprintf(stderr,"- Argument 1 must be a dictionary file.\n"); 
-    fprintf(stderr,"- Only 1 argument is required.\n"); 
-    exit(EXIT_FAILURE);    
+    fprintf(stderr,"- Argument 1 must be a dictionary file.\n");
+    fprintf(stderr,"- Argument 2 is optional, and must be -b for ");
+    fprintf(stderr,"batch mode, or -s or -a followed by a file to save ");
+    fprintf(stderr,"the dictionary or an analysis of it to.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+void checkErr(wlerr err)
+{
+  if (err != wl_ok) {
+    fprintf(stderr,"ERROR: %s\n", wlError(err));
+    exit(EXIT_FAILURE);
   }
 }
 
@@ -147,274 +228,481 @@ void checkInput(char *sourceword, char *targetword)
   }
 }
 
-void checkFile(FILE *file)
+buffer createBuffer(wldict *dict)
+/* bases the buffer size on the longest word in the dictionary */
 {
-/* This is called every time the file is reopened in case another process 
- * has messed with it since the last time. */
-  if (file == NULL) {
-    fprintf(stderr, "ERROR: failed to open file - ");
-    fprintf(stderr,"check name and directory.\n");
+  buffer b;
+
+  b.size = wlMaxLen(dict) + 1;
+  b.str = (char *)malloc(sizeof(char) * (b.size + 1));
+  if (b.str == NULL) {
+    fprintf(stderr,"ERROR: buffer malloc failed\n");
     exit(EXIT_FAILURE);
   }
+  return b;
 }
 
-void getFileInfo(char **argv, buffer *b)
+int findNode(const wlgraph *g, char *s)
 {
-  FILE *file = fopen(argv[1], "r");
-  int cnt = 0;
-  
-  checkFile(file);
-  while ( fgets(b->str, b->size + 1, file) != NULL) {
-    b->str[strcspn(b->str,"\n")] = '\0'; /* removes the newline */  
-    if (checkWord(b->str,warn_on) && strlen(b->str) != 0) {
-      cnt++;
-    }
+  int id = wlFind(g, s);
+
+  if (id == -1) {
+    fprintf(stderr,"ERROR: %s not found in list\n", s);
+    exit(EXIT_FAILURE);
   }
-  fclose(file);
-  printf("%d words read\n",cnt);
+  return id;
 }
 
-void createListfromFile(list *wlist, char **argv, buffer *b)
+char* createString(int wlen, char *s)
 {
-  /* This is the only function which needs to modify struct list, so it 
-   * is passed a pointer not a copy */
-  FILE *file = fopen(argv[1], "r"); 
-  checkFile(file);
-  
-  while ( fgets(b->str, b->size + 1, file) != NULL) {
-    b->str[strcspn(b->str,"\n")] = '\0'; /* removes the newline */
-    if ((int)strlen(b->str) == wlist->wlen 
-    &&  checkWord(b->str,warn_off)) {
-      lowerCase(b->str);
-      if (wlist->head == NULL) {
-        wlist->head = wlist->tail
-          = createNode(createString(wlist->wlen,b->str));
-      }
-      else {
-        wlist->tail->next
-          = createNode(createString(wlist->wlen,b->str));
-        wlist->tail = wlist->tail->next;
-      }
-    }
+  char *str = (char *)malloc(sizeof(char) * wlen + 1);
+  if (str == NULL) {
+    fprintf(stderr,"ERROR: string malloc failed\n");
+    exit(EXIT_FAILURE);
   }
-  fclose(file);
+  strcpy(str, s);
+  str[wlen] = '\0';
+
+  return str;
 }
 
-int checkWord( char *s, warnings w)
+void printLadder(const wlgraph *g, const int *path, int len)
 {
   int i;
 
-  for (i = 0; s[i]; i++)  {
-    if (!isalpha(s[i])) {
-      if (w == warn_on) {
-        fprintf(stderr,"WARNING: %s was read from ", s);
-        fprintf(stderr,"dictionary but discarded.\n");
-      }
-      return 0;
+  for (i = 0; i < len; i++) {
+    if (i > 0) {
+      printf(" -> ");
     }
+    if (i % PRINTWIDTH == 0) {
+      printf("\n");
+    }
+    printf("%s",wlWord(g, path[i]));
   }
-  return 1;
 }
 
-buffer createBuffer(char **argv)
-/* bases the buffer size on the longest word in the dictionary file */
+void printResults(const wlgraph *g, const int *path, int len)
 {
-  FILE *file = fopen(argv[1], "r");
-  int cnt = 0, maxcnt = 0;
-  char c;
-  buffer b;
-  
-  checkFile(file);
-  while((c = fgetc(file)) != EOF) {
-    cnt++;
-    if (c == '\n') {
-      if (cnt > maxcnt) {
-        maxcnt = cnt;
-      }
-      cnt = 0;
-    }
+  if (len > 0) {
+    printLadder(g, path, len);
   }
-  fclose(file);
-  b.size = maxcnt;
-  b.str = (char *)malloc(sizeof(char) * b.size);
-  if (b.str == NULL) {
-    fprintf(stderr,"ERROR: buffer malloc failed\n");
-    exit(EXIT_FAILURE);
+  else {
+    printf("\nNo ladder possible between these words!");
+  }
+  printf("\n\n");
+}
+
+void lowerCase( char *s)
+{
+  int i;
+
+  for (i = 0; s[i]; i++)  {
+    s[i] = tolower(s[i]);
   }
-  return b;
 }
 
-void findChildren(list wlist, node *parent, queue *q)
+void runBatch(const wldict *dict, wlwatch *w)
+/* with w, each block of queries is answered from its latest dictionary */
 {
-  node *n = wlist.head; /* this assignment is just to avoid pointer chasing a  
-  * var named head, which could be misleading */ 
-  
-  parent->visited = visited;
-  while (n != NULL) {
-    if (n->visited != visited && findEd(n,parent) == 1 ) {
-      n->parent = parent;
-      n->visited = visited;
-      enQueue(n,q);
+  query *qs = (query *)malloc(sizeof(query) * BATCHLINES);
+  int i, nq, lanes = getLanes();
+
+  if (qs == NULL) {
+    fprintf(stderr,"ERROR: query malloc failed\n");
+    exit(EXIT_FAILURE);
+  }
+  while ((nq = readQueries(qs, BATCHLINES)) > 0) {
+    if (w != NULL) {
+      dict = wlAcquire(w);
+    }
+    answerQueries(dict, qs, nq, lanes);
+    if (w != NULL) {
+      wlRelease(w, dict);
     }
-    n = n->next;
+    for (i = 0; i < nq; i++) {
+      printf("%s\n", qs[i].answer);
+      free(qs[i].sourceword);
+      free(qs[i].targetword);
+      free(qs[i].answer);
+    }
+  }
+  free(qs);
+}
+
+void saveDict(wldict *dict, char *path)
+{
+  if (getCompact()) {
+    checkErr(wlCompact(dict, 0));
   }
+  checkErr(wlLandmarks(dict, getLandmarks(), 0));
+  checkErr(wlHubLabels(dict, 0));
+  checkErr(wlSave(dict, path));
+  printf("%d words saved to %s\n", wlWordCount(dict), path);
 }
 
-int findEd(node* n1, node* n2)
-/* ed: edit distance */
+void analyseDict(const wldict *dict, char *path)
+/* each length is written out as soon as it is done */
 {
-  int i, ed;
-  
-  for(i = 0, ed = 0; n1->word[i]; i++) {
-    if (n1->word[i] != n2->word[i]) {
-      ed++;
+  FILE *out = fopen(path, "w");
+  int wlen;
+
+  if (out == NULL) {
+    checkErr(wl_nofile);
+  }
+  for (wlen = 1; wlen <= wlMaxLen(dict); wlen++) {
+    if (wlGraph(dict, wlen) != NULL) {
+      analyseLength(wlGraph(dict, wlen), out);
+      fflush(out);
     }
   }
-  return ed;
+  if (fclose(out) != 0) {
+    checkErr(wl_nofile);
+  }
+  printf("%d words analysed into %s\n", wlWordCount(dict), path);
 }
 
-node *findNode(list wlist, char *s)
+void analyseLength(const wlgraph *g, FILE *out)
 {
-  node *n = wlist.head; /* this assignment is just to avoid pointer chasing a  
-  * var named head, which could be misleading */ 
-  
-  while (n != NULL) {
-    if (strcmp(n->word,s) == 0) {
-      return n;
+  int n = wlSize(g);
+  int *ecc = (int *)malloc(sizeof(int) * n);
+  int *comp = (int *)malloc(sizeof(int) * n);
+  int *size = (int *)calloc(n, sizeof(int));
+  int *count = (int *)calloc(n + 1, sizeof(int));
+  int i, searches, diam = 0, first;
+
+  if (ecc == NULL || comp == NULL || size == NULL || count == NULL) {
+    checkErr(wl_nomem);
+  }
+  checkErr(wlEccentricities(g, 0, ecc, comp, &searches));
+  fprintf(out, "length %d: %d words, %d searches\n", wlLength(g), n,
+          searches);
+
+  for (i = 0; i < n; i++) {
+    size[comp[i]]++;
+    if (ecc[i] > diam) {
+      diam = ecc[i];
+    }
+  }
+  for (i = 0; i < n; i++) {
+    count[size[i]]++; /* how many components have each size */
+  }
+  fprintf(out, "components:");
+  for (i = n, first = 1; i > 0; i--) {
+    if (count[i] > 0) {
+      fprintf(out, "%s %d x %d", first ? "" : ",", i, count[i]);
+      first = 0;
     }
-    n = n->next;
   }
-  fprintf(stderr,"ERROR: %s not found in list\n", s);
-  exit(EXIT_FAILURE);
+  fprintf(out, "\ndiameter: %d steps\n", diam);
+
+  memset(count, 0, sizeof(int) * (n + 1));
+  for (i = 0; i < n; i++) {
+    count[ecc[i]]++;
+  }
+  fprintf(out, "eccentricity:");
+  for (i = 0, first = 1; i <= diam; i++) {
+    if (count[i] > 0) {
+      fprintf(out, "%s %d x %d", first ? "" : ",", i, count[i]);
+      first = 0;
+    }
+  }
+  fprintf(out, "\n");
+
+  if (diam > 0) {
+    printHardest(g, ecc, diam, out);
+  }
+  for (i = 0; i < n; i++) {
+    fprintf(out, "%s %d %d\n", wlWord(g, i), ecc[i], comp[i]);
+  }
+  fprintf(out, "\n");
+  free(ecc);
+  free(comp);
+  free(size);
+  free(count);
 }
 
-node *createNode(char *s)
+void printHardest(const wlgraph *g, const int *ecc, int diam, FILE *out)
+/* Only words whose eccentricity is the diameter can start a hardest
+ * ladder, so one BFS from each of those finds every one. */
 {
-  node *p;
+  int *dist = (int *)malloc(sizeof(int) * wlSize(g));
+  const int *path;
+  wlsearch *s;
+  char *str;
+  int u, v, len;
 
-  p = (node *)malloc(sizeof(node));
-  if (p == NULL) {
-    fprintf(stderr,"ERROR: node malloc failed\n");
-    exit(EXIT_FAILURE);
+  if (dist == NULL) {
+    checkErr(wl_nomem);
   }
-  p->word = s;
-  p->visited = unvisited;
-  p->qnext = NULL;
-  p->next = NULL;
-  p->parent = NULL;
-  
-  return p;
+  checkErr(wlSearchNew(g, &s));
+  for (u = 0; u < wlSize(g); u++) {
+    if (ecc[u] != diam) {
+      continue;
+    }
+    checkErr(wlDistances(s, u, dist, NULL));
+    for (v = u + 1; v < wlSize(g); v++) {
+      if (dist[v] == diam) {
+        checkErr(wlLadder(s, u, v, &path, &len));
+        str = formatLadder(g, path, len);
+        fprintf(out, "hardest: %s\n", str);
+        free(str);
+      }
+    }
+  }
+  wlSearchFree(s);
+  free(dist);
 }
 
-char* createString(int wlen, char *s)
+int getLandmarks(void)
 {
-  char *str = (char *)malloc(sizeof(char) * wlen + 1);
-  if (str == NULL) {
-    fprintf(stderr,"ERROR: string malloc failed\n");
-    exit(EXIT_FAILURE);
+  char *env = getenv("WL_LANDMARKS");
+  int k = env != NULL ? atoi(env) : LANDMARKS;
+
+  if (k < 1 || k > WL_MAXLANDMARKS) {
+    fprintf(stderr,"WARNING: WL_LANDMARKS must be from 1 to %d - ",
+            WL_MAXLANDMARKS);
+    fprintf(stderr,"using %d.\n", LANDMARKS);
+    k = LANDMARKS;
   }
-  strcpy(str, s);
-  str[wlen] = '\0';
+  return k;
+}
 
-  return str;
+int getCompact(void)
+{
+  char *env = getenv("WL_COMPACT");
+
+  return env != NULL && atoi(env) != 0;
 }
 
-void printLadder (node *end)
+int getReload(void)
+/* 0 unless WL_RELOAD gives how often, in ms, to look for a new dictionary */
 {
-  static int cnt = 0;
-  node *n = end; /* this assignment is just to avoid pointer chasing a var 
-  * named end, while still showing that the function hould be passed the
-  * ladder's end. */ 
-   
-  if (n == NULL) {
-    return; /* base case */
-  }
-  /* has to be recursive in order to print the right way round */
-  printLadder(n->parent);
-  if (n->parent != NULL) {
-    printf(" -> ");
-  }
-  if (cnt % PRINTWIDTH == 0) {
-    printf("\n");
-  }
-  printf("%s",n->word);
-  cnt++;
+  char *env = getenv("WL_RELOAD");
+  int ms = env != NULL ? atoi(env) : 0;
+
+  if (ms < 0) {
+    fprintf(stderr,"WARNING: WL_RELOAD must be at least 0 - using 0.\n");
+    ms = 0;
+  }
+  return ms;
 }
 
-void printResults(ladder wladder)
+int getLanes(void)
 {
-  if (wladder.end->parent != NULL) {
-    printLadder(wladder.end);
+  char *env = getenv("WL_LANES");
+  int lanes = env != NULL ? atoi(env) : 0;
+
+  if (env != NULL
+  &&  lanes != 1 && lanes != 64 && lanes != 128 && lanes != 256) {
+    fprintf(stderr,"WARNING: WL_LANES must be 1, 64, 128 or 256 - ");
+    fprintf(stderr,"choosing for each length.\n");
+    lanes = 0;
   }
-  else {
-    printf("\nNo ladder possible between these words!");
+  return lanes; /* 0 to let wlBatchLanes() choose */
+}
+
+int readQueries(query *qs, int max)
+/* reads up to max lines of two words, lowercased - blank lines are skipped,
+ * and anything else on a line is ignored */
+{
+  char line[256], src[128], dst[128];
+  int nq = 0;
+
+  while (nq < max && fgets(line, sizeof(line), stdin) != NULL) {
+    src[0] = dst[0] = '\0';
+    if (sscanf(line, "%127s %127s", src, dst) < 1) {
+      continue;
+    }
+    lowerCase(src);
+    lowerCase(dst);
+    qs[nq].sourceword = createString(strlen(src), src);
+    qs[nq].targetword = createString(strlen(dst), dst);
+    qs[nq].answer = NULL;
+    nq++;
   }
-  printf("\n\n");
+  return nq;
 }
 
-void lowerCase( char *s)
+void answerQueries(const wldict *dict, query *qs, int nq, int lanes)
+/* the queries for each word length are answered together */
 {
-  int i;
+  int *which = (int *)malloc(sizeof(int) * nq);
+  const wlgraph *g;
+  int i, n, wlen;
 
-  for (i = 0; s[i]; i++)  {
-    s[i] = tolower(s[i]);
+  if (which == NULL) {
+    fprintf(stderr,"ERROR: query malloc failed\n");
+    exit(EXIT_FAILURE);
+  }
+  for (wlen = 1; wlen <= wlMaxLen(dict); wlen++) {
+    if ((g = wlGraph(dict, wlen)) == NULL) {
+      continue;
+    }
+    for (i = n = 0; i < nq; i++) {
+      if ((int)strlen(qs[i].sourceword) == wlen) {
+        which[n++] = i;
+      }
+    }
+    answerLength(g, qs, which, n, lanes > 0 ? lanes : wlBatchLanes(g));
+  }
+  for (i = 0; i < nq; i++) {
+    if (qs[i].answer == NULL) {
+      qs[i].answer = checkQuery(NULL, &qs[i]);
+    }
   }
+  free(which);
 }
 
-void freeList (list wlist)
+void answerLength(const wlgraph *g, query *qs, int *which, int n, int lanes)
+/* Runs the queries in which, all with words of g's length, lanes at a 
+ * time.  Queries that fail checkQuery() are answered without searching. */
 {
-  node *temp;
-  node *n = wlist.head; /* this assignment is just to avoid pointer chasing a  
-  * var named head, which could be misleading */ 
-   
-  while (n != NULL) {
-    temp = n;
-    n = n->next;
-    free(temp->word);
-    free(temp);
+  wlbatch *b = NULL;
+  wlsearch *s = NULL;
+  int starts[WL_MAXLANES], ends[WL_MAXLANES], lane[WL_MAXLANES];
+  const int *path;
+  int i, q, nl, len;
+  wlerr err;
+  STAT(wlstats st);
+
+  if (lanes == 1) {
+    checkErr(wlSearchNew(g, &s));
   }
+  else {
+    checkErr(wlBatchNew(g, lanes, &b));
+  }
+  for (i = 0; i < n; ) {
+    for (nl = 0; i < n && nl < (lanes == 1 ? 1 : lanes); i++) {
+      q = which[i];
+      if ((qs[q].answer = checkQuery(g, &qs[q])) == NULL) {
+        starts[nl] = wlFind(g, qs[q].sourceword);
+        ends[nl] = wlFind(g, qs[q].targetword);
+        lane[nl++] = q;
+      }
+    }
+    if (b != NULL) {
+      checkErr(wlBatchLadders(b, starts, ends, nl));
+      STAT(wlBatchStats(b, &st));
+    }
+    for (q = 0; q < nl; q++) {
+      if (b != NULL) {
+        err = wlBatchPath(b, q, &path, &len);
+      }
+      else {
+        err = wlLadder(s, starts[q], ends[q], &path, &len);
+        STAT(wlStats(s, &st));
+      }
+      if (err == wl_ok) {
+        qs[lane[q]].answer = formatLadder(g, path, len);
+      }
+      else if (err == wl_noladder) {
+        qs[lane[q]].answer = 
+          formatError("No ladder possible between these words!", NULL);
+      }
+      else {
+        checkErr(err);
+      }
+      STAT(statsRecord(qs[lane[q]].sourceword, qs[lane[q]].targetword, &st,
+                       err == wl_ok ? len : 0));
+    }
+  }
+  wlBatchFree(b);
+  wlSearchFree(s);
 }
 
-void queueInit(queue *q)
+char *checkQuery(const wlgraph *g, query *q)
+/* the batch mode version of checkInput() and findNode(), which returns an 
+ * answer for a query that can't be searched, or NULL if it can */
 {
-  q->front = q->back = NULL;
+  if (strlen(q->sourceword) != strlen(q->targetword)) {
+    return formatError("ERROR: source and target words must be of equal "
+                       "length", NULL);
+  }
+  if (strcmp(q->sourceword,q->targetword) == 0) {
+    return formatError("ERROR: two different words required!", NULL);
+  }
+  if (g == NULL) {
+    return formatError("ERROR: There are no words of this length in the "
+                       "dictionary file.", NULL);
+  }
+  if (wlFind(g, q->sourceword) == -1) {
+    return formatError("ERROR: %s not found in list", q->sourceword);
+  }
+  if (wlFind(g, q->targetword) == -1) {
+    return formatError("ERROR: %s not found in list", q->targetword);
+  }
+  return NULL;
 }
 
-node *deQueue(queue *q)
+char *formatLadder(const wlgraph *g, const int *path, int len)
+/* the whole ladder on one line */
 {
-  node *n = q->front;
+  char *str = (char *)malloc((wlLength(g) + 4) * len + 1);
+  int i;
 
-  if (n != NULL) {
-    q->front = q->front->qnext;
-    n->qnext = NULL; /* remove stray queue pointers */
-    if (q->front == NULL) {
-      q->back = NULL; /* properly empties the queue */
+  if (str == NULL) {
+    fprintf(stderr,"ERROR: string malloc failed\n");
+    exit(EXIT_FAILURE);
+  }
+  str[0] = '\0';
+  for (i = 0; i < len; i++) {
+    if (i > 0) {
+      strcat(str, " -> ");
     }
+    strcat(str, wlWord(g, path[i]));
   }
-  else {
-    fprintf(stderr,"ERROR: attempted to deQueue() empty queue\n");
+  return str;
+}
+
+char *formatError(char *msg, char *word)
+/* msg may have one %s, for word */
+{
+  char *str = (char *)malloc(strlen(msg) + (word ? strlen(word) : 0) + 1);
+
+  if (str == NULL) {
+    fprintf(stderr,"ERROR: string malloc failed\n");
     exit(EXIT_FAILURE);
   }
-  return n;
+  sprintf(str, msg, word);
+  return str;
 }
 
-void enQueue(node *n, queue *q)
+#ifdef WL_STATS
+void statsRecord(char *sourceword, char *targetword, wlstats *st, int len)
+/* One line per query, as space separated key=value pairs, on stderr so that
+ * it can be split from the ladders.  Queries searched together in a batch
+ * share its counts. */
 {
-  if (q->back != NULL) {
-    q->back->qnext = n;
-    q->back = n;
+  int i, bin = 0;
+
+  fprintf(stderr,"STATS: source=%s target=%s length=%d ", sourceword,
+          targetword, len);
+  fprintf(stderr,"dequeued=%ld checked=%ld bytes=%ld ", st->dequeued,
+          st->checked, st->bytes);
+  fprintf(stderr,"load=%.6f build=%.6f search=%.6f frontier=",
+          st->time[wl_load], st->time[wl_build], st->time[wl_search]);
+  for (i = 0; i < st->levels; i++) {
+    fprintf(stderr,"%s%ld", i > 0 ? "," : "", st->frontier[i]);
   }
-  else {
-    q->back = q->front = n;
+  fprintf(stderr,"\n");
+
+  while (bin < HISTBINS - 1 && (1L << (bin + 1)) <= st->dequeued) {
+    bin++;
   }
+  sum.hist[bin]++;
+  sum.queries++;
 }
 
-int queueEmpty(queue *q)
+void statsSummary(void)
 {
-  if(q->front == NULL) {
-    return 1;
-  }
-  else {
-    return 0;
+  int i;
+
+  fprintf(stderr,"STATS: %ld queries by nodes dequeued\n", sum.queries);
+  for (i = 0; i < HISTBINS; i++) {
+    if (sum.hist[i] > 0) {
+      fprintf(stderr,"STATS: [%ld, %ld) %ld\n", i == 0 ? 0L : 1L << i,
+              1L << (i + 1), sum.hist[i]);
+    }
   }
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,154 @@
+/* libwordladder - the word ladder engine without the interactive parts.
+ * A dictionary file is loaded once into a wldict, which holds a graph for
+ * each word length: the words, numbered in dictionary order (until
+ * wlCompact() renumbers them), and which of them are one letter apart.
+ * Once loaded a dictionary is never written to, so any number of threads
+ * can search it at the same time, each with its own wlsearch context.
+ * Nothing in the library prints or exits - every failure is returned as a
+ * wlerr, which wlError() turns into a message.
+ * Build with the front-end of your choice, e.g.
+ *   cc -O2 -o wordladder wordladder.c wlgraph.c wlsearch.c wlindex.c \
+ *      wllabel.c wlfile.c wlcode.c wlwatch.c wlkern.c wlecc.c -lpthread
+ * and add -DWL_STATS to every file to count what each search costs, or
+ * -DWL_GENERIC to use no word-length specific code (see wlkern.c).
+ */
+#ifndef WORDLADDER_H
+#define WORDLADDER_H
+
+#define WL_MAXLEVELS 64 /* deepest BFS level given its own frontier count */
+#define WL_MAXLANES 256 /* most searches a wlbatch can run at once */
+#define WL_MAXLANDMARKS 32 /* most landmarks wlLandmarks() will pick */
+
+typedef struct wldict wldict; /* a loaded dictionary */
+typedef struct wlgraph wlgraph; /* the words of one length, and their links */
+typedef struct wlsearch wlsearch; /* one thread's search state for a graph */
+typedef struct wlbatch wlbatch; /* the same, for many searches at once */
+typedef struct wlwatch wlwatch; /* a dictionary kept up to date with its file */
+
+typedef enum wlerr {
+  wl_ok,
+  wl_nofile, /* the dictionary couldn't be opened */
+  wl_nomem,
+  wl_badlen, /* no words of that length */
+  wl_notfound, /* the word or word number isn't in the graph */
+  wl_noladder, /* the words aren't connected */
+  wl_badarg, /* an argument is out of range */
+  wl_badfile /* a saved dictionary is damaged or from another version */
+} wlerr;
+
+typedef enum wlphase { wl_load, wl_build, wl_search, wl_nphases } wlphase;
+
+typedef struct wlstats {
+  long dequeued; /* nodes taken off the queue */
+  long checked; /* neighbours looked at */
+  long frontier[WL_MAXLEVELS]; /* nodes first reached at each level */
+  int levels;
+  long bytes; /* heap bytes allocated by the dictionary and the search */
+  double time[wl_nphases]; /* wall-clock seconds per phase */
+} wlstats;
+
+const char *wlError(wlerr err);
+
+/* Loads the words of length wlen from the file at path, or every length if
+ * wlen is 0.  nthreads is the number of threads used to build the graphs -
+ * 0 means the value of WL_THREADS, or failing that the number of cores.
+ * A file written by wlSave() is mapped read-only with its graphs ready
+ * built, so that processes loading the same file share its pages. */
+wlerr wlLoad(const char *path, int wlen, int nthreads, wldict **dict);
+void  wlFree(wldict *dict);
+/* Writes the dictionary, graphs and landmarks to path in this machine's
+ * byte order, for wlLoad() to read back without building anything.  The
+ * file is replaced in one step, so processes that have already loaded the
+ * old one carry on with it undisturbed. */
+wlerr wlSave(const wldict *dict, const char *path);
+/* Renumbers each graph's words so that neighbours have nearby numbers, and
+ * packs the links between them into a fraction of the space.  Word numbers
+ * from before are no longer valid.  Call it straight after wlLoad() - it is
+ * wl_badarg once there are landmarks or labels, or on a saved dictionary. */
+wlerr wlCompact(wldict *dict, int nthreads);
+int   wlWordCount(const wldict *dict); /* words read, of any length */
+int   wlSkipped(const wldict *dict); /* words discarded as not alphabetic */
+int   wlMaxLen(const wldict *dict);
+
+/* NULL if the dictionary has no words of length wlen */
+const wlgraph *wlGraph(const wldict *dict, int wlen);
+int   wlSize(const wlgraph *g);
+int   wlLength(const wlgraph *g);
+const char *wlWord(const wlgraph *g, int id);
+int   wlFind(const wlgraph *g, const char *word); /* -1 if not found */
+/* Points nbrs at word id's neighbours, in ascending order, and returns how
+ * many there are.  buf, with room for wlMaxDegree(g) ints, is where they
+ * are unpacked if the graph is compacted. */
+int   wlNeighbours(const wlgraph *g, int id, int *buf, const int **nbrs);
+int   wlMaxDegree(const wlgraph *g);
+
+/* Picks k landmarks for each length and keeps every word's distance from
+ * each of them, so that searches can be steered towards their end and
+ * ladder lengths estimated.  Call it before creating any searches.  A saved
+ * dictionary keeps the landmarks it was saved with - wl_badarg if asked for
+ * new ones. */
+wlerr wlLandmarks(wldict *dict, int k, int nthreads);
+/* Lower and upper bounds on the number of words in the ladder from start to
+ * end, found without searching.  wl_noladder if they aren't connected -
+ * which, without landmarks, isn't known and upper is just wlSize(g). */
+wlerr wlBounds(const wlgraph *g, int start, int end, int *lower, int *upper);
+/* Labels every word with the hubs it shares with every other, giving exact
+ * ladder lengths without searching (see wlLadderLen()), and bounds that are
+ * exact too.  Uses a few bytes per word per hub; the same rules as for
+ * wlLandmarks() apply. */
+wlerr wlHubLabels(wldict *dict, int nthreads);
+/* Every word's eccentricity - the most steps from it to any word it is
+ * connected to, 0 if it has no neighbours - and the number of its connected
+ * component.  ecc and comp need room for wlSize(g) ints.  searches, if not
+ * NULL, is given the number of BFSs it took, which bounds on the
+ * eccentricities keep to a small part of wlSize(g). */
+wlerr wlEccentricities(const wlgraph *g, int nthreads, int *ecc, int *comp,
+                       int *searches);
+
+wlerr wlSearchNew(const wlgraph *g, wlsearch **s);
+void  wlSearchFree(wlsearch *s);
+/* Finds a shortest ladder.  path is left pointing at the word numbers from
+ * start to end, which stay valid until s is next used.  With hub labels the
+ * ladder is read straight off them; otherwise the search is an A* guided by
+ * the landmarks if the graph has them, or else a BFS. */
+wlerr wlLadder(wlsearch *s, int start, int end, const int **path, int *len);
+/* Only the number of words in a shortest ladder.  With hub labels that
+ * takes no search, and s isn't touched. */
+wlerr wlLadderLen(wlsearch *s, int start, int end, int *len);
+/* A BFS from word from to every word it can reach.  dist, which needs room
+ * for wlSize() ints, is left with each word's steps to from, or -1 if it
+ * can't reach it.  toward, if not NULL, is given a neighbour of each word
+ * that is a step nearer from, or -1 for from itself and unreached words. */
+wlerr wlDistances(wlsearch *s, int from, int *dist, int *toward);
+void  wlStats(const wlsearch *s, wlstats *st); /* zeros without WL_STATS */
+
+/* A batch runs up to lanes (64, 128 or 256) searches on one graph together,
+ * so that each pass over the links moves every search on by a level. */
+wlerr wlBatchNew(const wlgraph *g, int lanes, wlbatch **b);
+void  wlBatchFree(wlbatch *b);
+/* The lanes worth giving a batch on g, or 1 where a search per query is
+ * quicker */
+int   wlBatchLanes(const wlgraph *g);
+/* Searches from starts[q] to ends[q] for q from 0 to nq-1 */
+wlerr wlBatchLadders(wlbatch *b, const int *starts, const int *ends, int nq);
+/* Gives search q's result, and its path as for wlLadder() - valid until the
+ * next wlBatchLadders() */
+wlerr wlBatchPath(const wlbatch *b, int q, const int **path, int *len);
+void  wlBatchStats(const wlbatch *b, wlstats *st);
+
+/* Loads path as wlLoad() does, then looks at it every ms milliseconds and
+ * reloads it in the background whenever its modification or change time,
+ * size or inode differ from the last load.  Times are compared to the
+ * nanosecond, but only as finely as the filesystem keeps them. */
+wlerr wlWatchNew(const char *path, int wlen, int nthreads, int ms,
+                 wlwatch **w);
+/* Every dictionary acquired must have been released first */
+void  wlWatchFree(wlwatch *w);
+/* The latest dictionary, which stays valid - whatever reloads happen - until
+ * it is handed back to wlRelease().  Searches and batches made on its graphs
+ * must be freed before then. */
+const wldict *wlAcquire(wlwatch *w);
+void  wlRelease(wlwatch *w, const wldict *dict);
+int   wlReloads(wlwatch *w); /* how many times the file has been reloaded */
+
+#endif